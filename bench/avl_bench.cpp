@@ -0,0 +1,788 @@
+#include "AVL_Tree.h"
+#include "B_Tree.h"
+#include "Concurrent_AVL_Tree.h"
+#include "Sharded_AVL_Tree.h"
+#include "Write_Ahead_Log.h"
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Benchmarks of AVL_tree and other ordered containers. Every result is one JSON line:
+// {"benchmark": ..., "structure": ..., "stream": ..., "size": ..., "operations": ...,
+//  "ns_per_op": ..., "allocations": ..., "peak_rss_kb": ...}
+// Every group of benchmarks runs in its own process, so the peak RSS belongs to the group.
+
+// all allocations of the process are counted
+static std::atomic<long long> allocations(0);
+
+// the replaced operators only call these helpers, so new and delete are not paired with malloc and free directly
+static void * counted_alloc(std::size_t size, std::size_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    void * pointer = alignment == 0 ? std::malloc(size == 0 ? 1 : size)
+                                    : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+static void counted_free(void * pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void * operator new(std::size_t size)
+{
+    return counted_alloc(size, 0);
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+    return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void * pointer) noexcept
+{
+    counted_free(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept
+{
+    counted_free(pointer);
+}
+
+void operator delete(void * pointer, std::align_val_t) noexcept
+{
+    counted_free(pointer);
+}
+
+void operator delete(void * pointer, std::size_t, std::align_val_t) noexcept
+{
+    counted_free(pointer);
+}
+
+using pbds_tree = __gnu_pbds::tree<int, __gnu_pbds::null_type, std::less<int>, __gnu_pbds::rb_tree_tag,
+                                   __gnu_pbds::tree_order_statistics_node_update>;
+
+struct Options
+{
+    long long min_size_ = 1000;
+    long long max_size_ = 1000000;
+    long long queries_ = 100000;   // queries in one measurement
+    int max_threads_ = 0;          // readers of the concurrent benchmark and shards, 0 is the number of cores
+    double seconds_ = 0.2;         // time of one concurrent measurement
+    std::string filter_;           // only structures with this substring in the name
+};
+
+// time and allocations of one measured part
+class Measure
+{
+    private:
+        std::chrono::steady_clock::time_point start_;
+        long long allocations_;
+    public:
+        Measure()
+        {
+            allocations_ = allocations.load(std::memory_order_relaxed);
+            start_ = std::chrono::steady_clock::now();
+        }
+        double nanoseconds() const
+        {
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_).count();
+        }
+        long long allocations_since() const
+        {
+            return allocations.load(std::memory_order_relaxed) - allocations_;
+        }
+};
+
+struct Group
+{
+    const Options & options_;
+    std::string structure_;
+    std::string stream_;
+    long long size_;
+    void report(const char * benchmark, long long operations, const Measure & measure, const char * extra = "") const
+    {
+        // nanoseconds and allocations are taken before the output
+        double nanoseconds = measure.nanoseconds();
+        long long allocated = measure.allocations_since();
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        std::printf("{\"benchmark\": \"%s\", \"structure\": \"%s\", \"stream\": \"%s\", \"size\": %lld, "
+                    "\"operations\": %lld, \"ns_per_op\": %.2f, \"allocations\": %lld, \"peak_rss_kb\": %ld%s}\n",
+                    benchmark, structure_.c_str(), stream_.c_str(), size_,
+                    operations, operations > 0 ? nanoseconds / operations : 0.0, allocated, usage.ru_maxrss, extra);
+        std::fflush(stdout);
+    }
+};
+
+// results of queries are added here, so the compiler can not throw queries away
+static std::atomic<long long> sink(0);
+
+int scramble(std::uint64_t x)
+{
+    // a bijection which mixes bits, it spreads ranks of zipf keys over all integers
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return static_cast<int>(x & 0x7fffffff);
+}
+
+std::vector<int> make_keys(const std::string & stream, long long size, std::mt19937_64 & generator)
+{
+    std::vector<int> keys(size);
+
+    if (stream == "sequential")
+    {
+        for (long long i = 0; i < size; ++i)
+            keys[i] = static_cast<int>(i);
+    }
+    else if (stream == "random")
+    {
+        std::uniform_int_distribution<int> distribution(0, INT32_MAX);
+
+        for (long long i = 0; i < size; ++i)
+            keys[i] = distribution(generator);
+    }
+    else if (stream == "zipf")
+    {
+        // zipf with theta 0.99 over size keys by the method of Gray et al.
+        const double theta = 0.99;
+        double zeta_n = 0;
+
+        for (long long i = 1; i <= size; ++i)
+            zeta_n += 1.0 / std::pow(static_cast<double>(i), theta);
+
+        double zeta_2 = 1.0 + 1.0 / std::pow(2.0, theta);
+        double alpha = 1.0 / (1.0 - theta);
+        double eta = (1.0 - std::pow(2.0 / size, 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+        std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+        for (long long i = 0; i < size; ++i)
+        {
+            double u = distribution(generator);
+            double uz = u * zeta_n;
+            long long rank = uz < 1.0 ? 0 :
+                             uz < zeta_2 ? 1 :
+                             static_cast<long long>(size * std::pow(eta * u - eta + 1.0, alpha));
+
+            keys[i] = scramble(std::min(rank, size - 1));
+        }
+    }
+    else // adversarial
+    {
+        // keys come from both ends to the middle, every insert goes to the deepest place
+        // and the tree is rebalanced by double rotations
+        for (long long i = 0, low = 0, high = size - 1; i < size; ++i)
+            keys[i] = static_cast<int>(i % 2 == 0 ? low++ : high--);
+    }
+
+    return keys;
+}
+
+std::vector<int> make_queries(const std::vector<int> & keys, long long count, std::mt19937_64 & generator)
+{
+    std::uniform_int_distribution<std::size_t> distribution(0, keys.size() - 1);
+    std::vector<int> queries(count);
+
+    for (long long i = 0; i < count; ++i)
+        queries[i] = keys[distribution(generator)] - static_cast<int>(i % 2);
+
+    return queries;
+}
+
+std::vector<int> make_ranks(long long size, long long count, std::mt19937_64 & generator)
+{
+    std::uniform_int_distribution<long long> distribution(1, size);
+    std::vector<int> ranks(count);
+
+    for (long long i = 0; i < count; ++i)
+        ranks[i] = static_cast<int>(distribution(generator));
+
+    return ranks;
+}
+
+template<typename Allocator>
+void bench_avl_tree(const Group & group, const std::vector<int> & keys, std::mt19937_64 & generator)
+{
+    long long sum = 0;
+    AVL_tree<int, std::less<int>, Allocator> tree;
+    tree.set_quiet(true);
+
+    {
+        Measure measure;
+        for (int key : keys)
+            tree.insert(key);
+        group.report("insert", keys.size(), measure);
+    }
+
+    long long size = tree.size();
+    long long count = std::min<long long>(group.options_.queries_, size);
+    std::vector<int> ranks = make_ranks(size, count, generator);
+    std::vector<int> queries = make_queries(keys, count, generator);
+
+    {
+        Measure measure;
+        for (int rank : ranks)
+            sum += tree.k_th_order_statistic(rank);
+        group.report("k_th_order_statistic", count, measure);
+    }
+    {
+        Measure measure;
+        for (int query : queries)
+            sum += tree.elem_less_than(query);
+        group.report("elem_less_than", count, measure);
+    }
+    {
+        std::vector<int> results(count);
+        {
+            Measure measure;
+            tree.k_th_batch(ranks, results);
+            group.report("k_th_batch", count, measure);
+        }
+        {
+            Measure measure;
+            tree.elem_less_than_batch(queries, results);
+            group.report("elem_less_than_batch", count, measure);
+        }
+    }
+    {
+        Measure measure;
+        for (int key : tree)
+            sum += key;
+        group.report("iterate", size, measure);
+    }
+    {
+        Measure build_measure;
+        Frozen_AVL_tree<int> frozen = tree.freeze();
+        group.report("freeze", size, build_measure);
+
+        Measure k_th_measure;
+        for (int rank : ranks)
+            sum += frozen.k_th_order_statistic(rank);
+        group.report("frozen_k_th_order_statistic", count, k_th_measure);
+
+        Measure less_measure;
+        for (int query : queries)
+            sum += frozen.elem_less_than(query);
+        group.report("frozen_elem_less_than", count, less_measure);
+    }
+    {
+        std::string path = "/tmp/avl_bench_" + std::to_string(getpid()) + ".snap";
+        {
+            Measure measure;
+            tree.save(path.c_str());
+            group.report("snapshot_save", size, measure);
+        }
+        {
+            AVL_tree<int, std::less<int>, Allocator> loaded;
+            Measure measure;
+            loaded.load(path.c_str());
+            group.report("snapshot_load", size, measure);
+        }
+        unlink(path.c_str());
+    }
+    {
+        AVL_tree<int, std::less<int>, Allocator> copy(tree);
+        long long erased = std::max<long long>(1, size / 10);
+        Measure measure;
+        copy.erase_rank_range(1, static_cast<int>(erased));
+        group.report("erase_rank_range", erased, measure);
+    }
+
+    // every element is removed once in a random order
+    std::vector<int> elements(tree.begin(), tree.end());
+    std::shuffle(elements.begin(), elements.end(), generator);
+    {
+        Measure measure;
+        for (int element : elements)
+            tree.remove(element);
+        group.report("remove", elements.size(), measure);
+    }
+
+    sink += sum;
+}
+
+// the same workloads as bench_avl_tree for the B+ tree with wide nodes
+template<typename Allocator>
+void bench_b_tree(const Group & group, const std::vector<int> & keys, std::mt19937_64 & generator)
+{
+    long long sum = 0;
+    B_tree<int, std::less<int>, Allocator> tree;
+    tree.set_quiet(true);
+
+    {
+        Measure measure;
+        for (int key : keys)
+            tree.insert(key);
+        group.report("insert", keys.size(), measure);
+    }
+
+    long long size = tree.size();
+    long long count = std::min<long long>(group.options_.queries_, size);
+    std::vector<int> ranks = make_ranks(size, count, generator);
+    std::vector<int> queries = make_queries(keys, count, generator);
+
+    {
+        Measure measure;
+        for (int rank : ranks)
+            sum += tree.k_th_order_statistic(rank);
+        group.report("k_th_order_statistic", count, measure);
+    }
+    {
+        Measure measure;
+        for (int query : queries)
+            sum += tree.elem_less_than(query);
+        group.report("elem_less_than", count, measure);
+    }
+    {
+        Measure measure;
+        for (int key : tree)
+            sum += key;
+        group.report("iterate", size, measure);
+    }
+
+    std::vector<int> elements(tree.begin(), tree.end());
+    std::shuffle(elements.begin(), elements.end(), generator);
+    {
+        Measure measure;
+        for (int element : elements)
+            tree.remove(element);
+        group.report("remove", elements.size(), measure);
+    }
+
+    sink += sum;
+}
+
+void bench_std_set(const Group & group, const std::vector<int> & keys, std::mt19937_64 & generator)
+{
+    long long sum = 0;
+    std::set<int> tree;
+
+    {
+        Measure measure;
+        for (int key : keys)
+            tree.insert(key);
+        group.report("insert", keys.size(), measure);
+    }
+
+    // rank queries scan the set, so there are less of them
+    long long size = tree.size();
+    long long count = std::min<long long>(group.options_.queries_, std::max<long long>(10, 20000000 / size));
+    std::vector<int> ranks = make_ranks(size, count, generator);
+    std::vector<int> queries = make_queries(keys, count, generator);
+
+    {
+        Measure measure;
+        for (int rank : ranks)
+            sum += *std::next(tree.begin(), rank - 1);
+        group.report("k_th_order_statistic", count, measure);
+    }
+    {
+        Measure measure;
+        for (int query : queries)
+            sum += std::distance(tree.begin(), tree.lower_bound(query));
+        group.report("elem_less_than", count, measure);
+    }
+    {
+        Measure measure;
+        for (int key : tree)
+            sum += key;
+        group.report("iterate", size, measure);
+    }
+
+    std::vector<int> elements(tree.begin(), tree.end());
+    std::shuffle(elements.begin(), elements.end(), generator);
+    {
+        Measure measure;
+        for (int element : elements)
+            tree.erase(element);
+        group.report("remove", elements.size(), measure);
+    }
+
+    sink += sum;
+}
+
+void bench_pbds_tree(const Group & group, const std::vector<int> & keys, std::mt19937_64 & generator)
+{
+    long long sum = 0;
+    pbds_tree tree;
+
+    {
+        Measure measure;
+        for (int key : keys)
+            tree.insert(key);
+        group.report("insert", keys.size(), measure);
+    }
+
+    long long size = tree.size();
+    long long count = std::min<long long>(group.options_.queries_, size);
+    std::vector<int> ranks = make_ranks(size, count, generator);
+    std::vector<int> queries = make_queries(keys, count, generator);
+
+    {
+        Measure measure;
+        for (int rank : ranks)
+            sum += *tree.find_by_order(rank - 1);
+        group.report("k_th_order_statistic", count, measure);
+    }
+    {
+        Measure measure;
+        for (int query : queries)
+            sum += tree.order_of_key(query);
+        group.report("elem_less_than", count, measure);
+    }
+    {
+        Measure measure;
+        for (int key : tree)
+            sum += key;
+        group.report("iterate", size, measure);
+    }
+
+    std::vector<int> elements(tree.begin(), tree.end());
+    std::shuffle(elements.begin(), elements.end(), generator);
+    {
+        Measure measure;
+        for (int element : elements)
+            tree.erase(element);
+        group.report("remove", elements.size(), measure);
+    }
+
+    sink += sum;
+}
+
+void bench_concurrent(const Group & group, const std::vector<int> & keys, std::mt19937_64 & generator)
+{
+    Concurrent_AVL_tree<int> tree;
+
+    {
+        Measure measure;
+        for (int key : keys)
+            tree.insert(key);
+        group.report("insert", keys.size(), measure);
+    }
+
+    int max_threads = group.options_.max_threads_ > 0 ? group.options_.max_threads_
+                                                       : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::uniform_int_distribution<std::size_t> distribution(0, keys.size() - 1);
+
+    // readers answer queries while one writer inserts and removes keys
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<long long> operations(0);
+        std::vector<std::thread> readers;
+        std::uint64_t seed = generator();
+
+        std::thread writer([&tree, &stop, &keys, seed]()
+        {
+            std::mt19937_64 writer_generator(seed);
+            std::uniform_int_distribution<std::size_t> position(0, keys.size() - 1);
+
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                int key = keys[position(writer_generator)];
+                tree.remove(key);
+                tree.insert(key);
+            }
+        });
+
+        Measure measure;
+
+        for (int i = 0; i < threads; ++i)
+        {
+            readers.emplace_back([&tree, &stop, &operations, &keys, seed, i]()
+            {
+                std::mt19937_64 reader_generator(seed + i + 1);
+                std::uniform_int_distribution<std::size_t> position(0, keys.size() - 1);
+                long long count = 0;
+                long long sum = 0;
+
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    int key = keys[position(reader_generator)];
+                    sum += tree.elem_less_than(key);
+                    // the size changes by one while the writer works
+                    sum += tree.k_th_order_statistic(1 + sum % std::max(1, tree.size() - 1));
+                    count += 2;
+                }
+
+                sink += sum;
+                operations += count;
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(group.options_.seconds_));
+        stop = true;
+
+        for (std::thread & reader : readers)
+            reader.join();
+        writer.join();
+
+        // ns_per_op is the time of one query in one reader thread
+        long long total = operations.load();
+        double seconds = measure.nanoseconds() / 1e9;
+        char extra[128];
+        std::snprintf(extra, sizeof(extra), ", \"threads\": %d, \"reader_ops_per_second\": %.0f",
+                      threads, total / seconds);
+        group.report("concurrent_readers", total / threads, measure, extra);
+    }
+}
+
+void bench_sharded(const Group & group, const std::vector<int> & keys, std::mt19937_64 & generator)
+{
+    // every key is inserted by 'k' and then there is 'm' or 'n' like in the input of the program
+    std::vector<Command> commands;
+    std::unordered_set<int> inserted;
+    commands.reserve(2 * keys.size());
+
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        commands.push_back(Command{'k', keys[i], 0});
+        inserted.insert(keys[i]);
+
+        if (generator() % 2 == 0)
+        {
+            commands.push_back(Command{'m', static_cast<int>(1 + generator() % inserted.size()), 0});
+        }
+        else
+        {
+            commands.push_back(Command{'n', keys[generator() % (i + 1)], 0});
+        }
+    }
+
+    long long sum = 0;
+
+    // one tree executes commands one after another like the program without --threads
+    {
+        AVL_tree<int, std::less<int>, Node_pool<int>> tree;
+        tree.set_quiet(true);
+
+        Measure measure;
+        for (const Command & command : commands)
+        {
+            if (command.letter_ == 'k')
+            {
+                tree.insert(command.value_);
+            }
+            else if (command.letter_ == 'm')
+            {
+                sum += tree.k_th_order_statistic(command.value_);
+            }
+            else
+            {
+                sum += tree.elem_less_than(command.value_);
+            }
+        }
+        group.report("sequential_commands", commands.size(), measure);
+    }
+
+    int max_threads = group.options_.max_threads_ > 0 ? group.options_.max_threads_
+                                                       : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const int batch_size = 1 << 16;
+    std::vector<Command_result> results(batch_size);
+
+    // the same commands on shards, the time includes the order of results
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        Sharded_AVL_tree<AVL_tree<int, std::less<int>, Node_pool<int>>> tree(threads);
+
+        Measure measure;
+        for (std::size_t first = 0; first < commands.size(); first += batch_size)
+        {
+            int count = static_cast<int>(std::min<std::size_t>(batch_size, commands.size() - first));
+
+            tree.start(commands.data() + first, count, results.data());
+            tree.finish();
+
+            for (int i = 0; i < count; ++i)
+                sum += results[i].value_;
+        }
+
+        double seconds = measure.nanoseconds() / 1e9;
+        char extra[128];
+        std::snprintf(extra, sizeof(extra), ", \"threads\": %d, \"commands_per_second\": %.0f",
+                      threads, commands.size() / seconds);
+        group.report("sharded_commands", commands.size(), measure, extra);
+    }
+
+    sink += sum;
+}
+
+void bench_write_ahead_log(const Group & group, const std::vector<int> & keys, std::mt19937_64 &)
+{
+    // every record is synced, so bigger batches need less syncs for the same inserts
+    for (int batch_size : {1, 16, 256, 4096})
+    {
+        std::string path = "/tmp/avl_bench_" + std::to_string(getpid()) + ".wal";
+        long long count = std::min<long long>(keys.size(), 100LL * batch_size);
+        AVL_tree<int, std::less<int>, Node_pool<int>> tree;
+        tree.set_quiet(true);
+
+        {
+            Write_ahead_log<int> log(batch_size, 0);
+            log.open(path.c_str(), [](char, int) {});
+
+            Measure measure;
+            for (long long i = 0; i < count; ++i)
+            {
+                if (tree.insert(keys[i]).second)
+                {
+                    log.insert(keys[i]);
+                }
+            }
+            log.sync();
+
+            char extra[64];
+            std::snprintf(extra, sizeof(extra), ", \"batch_size\": %d", batch_size);
+            group.report("wal_insert", count, measure, extra);
+        }
+
+        unlink(path.c_str());
+    }
+}
+
+// runs a group in a child process, so peak RSS and allocations do not mix between groups
+void run_group(const Options & options, const std::string & structure, const std::string & stream, long long size,
+               std::uint64_t seed, const std::function<void(const Group &, const std::vector<int> &, std::mt19937_64 &)> & bench)
+{
+    pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        std::mt19937_64 generator(seed);
+        std::vector<int> keys = make_keys(stream, size, generator);
+        Group group{options, structure, stream, size};
+
+        bench(group, keys, generator);
+        std::fflush(stdout);
+        _exit(0);
+    }
+    else if (pid > 0)
+    {
+        int status = 0;
+        waitpid(pid, &status, 0);
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::fprintf(stderr, "Benchmark %s on %s stream of %lld keys failed\n", structure.c_str(), stream.c_str(), size);
+        }
+    }
+    else
+    {
+        std::perror("fork");
+    }
+}
+
+void usage(const char * program)
+{
+    std::fprintf(stderr, "Usage: %s [--min-size n] [--max-size n] [--queries n] [--threads n] [--seconds s] [--filter text]\n", program);
+    std::fprintf(stderr, "Sizes go from min-size to max-size by a factor of 10 (1000 and 1000000 by default, up to 1e8).\n");
+    std::fprintf(stderr, "Only structures which contain the filter text are run.\n");
+}
+
+int main(int argc, char * argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--min-size") == 0 && i + 1 < argc)
+        {
+            options.min_size_ = std::atoll(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc)
+        {
+            options.max_size_ = std::atoll(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--queries") == 0 && i + 1 < argc)
+        {
+            options.queries_ = std::atoll(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            options.max_threads_ = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            options.seconds_ = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            options.filter_ = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.min_size_ < 1 || options.max_size_ < options.min_size_ || options.queries_ < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct Structure
+    {
+        const char * name_;
+        std::function<void(const Group &, const std::vector<int> &, std::mt19937_64 &)> bench_;
+    };
+    const std::vector<Structure> structures = {
+        {"avl_tree_node_pool", bench_avl_tree<Node_pool<int>>},
+        {"avl_tree_std_allocator", bench_avl_tree<std::allocator<int>>},
+        {"b_tree_node_pool", bench_b_tree<Node_pool<int>>},
+        {"b_tree_std_allocator", bench_b_tree<std::allocator<int>>},
+        {"std_set_linear_rank", bench_std_set},
+        {"pbds_tree", bench_pbds_tree},
+        {"concurrent_avl_tree", bench_concurrent},
+        {"sharded_avl_tree", bench_sharded},
+        {"write_ahead_log", bench_write_ahead_log},
+    };
+    const char * streams[] = {"sequential", "random", "zipf", "adversarial"};
+
+    for (long long size = options.min_size_; size <= options.max_size_; size *= 10)
+    {
+        for (const char * stream : streams)
+        {
+            for (const Structure & structure : structures)
+            {
+                if (std::string(structure.name_).find(options.filter_) == std::string::npos)
+                {
+                    continue;
+                }
+
+                // the same keys for all structures
+                run_group(options, structure.name_, stream, size, static_cast<std::uint64_t>(size) * 31 + stream[0], structure.bench_);
+            }
+        }
+    }
+
+    return 0;
+}
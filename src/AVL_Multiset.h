@@ -0,0 +1,327 @@
+#ifndef AVL_MULTISET_H_
+#define AVL_MULTISET_H_
+
+#include "AVL_Tree.h"
+
+// Multiset on AVL_tree: equal values are kept in one node with count_ copies and elements_
+// counts the copies, so order statistics and counts of smaller elements take O(log n)
+// for n different values. Iterators go through different values, count() gives their copies.
+template<typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>, typename Aggregate = No_aggregate<T>>
+class AVL_multiset : private AVL_tree<T, Compare, Allocator, Aggregate>
+{
+    private:
+        using tree = AVL_tree<T, Compare, Allocator, Aggregate>;
+        // every copy of every value from min to max, it is used to save a snapshot
+        class copy_iterator
+        {
+            private:
+                Node<T, Aggregate> * node_;
+                int copy_; // number of the current copy of the node
+            public:
+                copy_iterator(Node<T, Aggregate> * node) : node_(node), copy_(0) {}
+                const T & operator*() const
+                {
+                    return node_->value_;
+                }
+                copy_iterator & operator++()
+                {
+                    if (++copy_ == node_->count_)
+                    {
+                        node_ = tree::template iterator<T>::next(node_);
+                        copy_ = 0;
+                    }
+                    return *this;
+                }
+        };
+        void add_copies(Node<T, Aggregate> ** path[], int count, Node<T, Aggregate> * node, int copies); // the path goes from the root to node
+        Node<T, Aggregate> * find_node(const T & item) const;
+    public:
+        template<typename E>
+        using iterator = typename tree::template iterator<E>;
+        AVL_multiset();
+        explicit AVL_multiset(const Allocator & allocator);
+        explicit AVL_multiset(const Compare & comp, const Allocator & allocator = Allocator());
+        template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        AVL_multiset(InputIt first, InputIt last, const Compare & comp = Compare(), const Allocator & allocator = Allocator());
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last); // replace all elements, it takes O(n) for sorted values
+        // a copy of a value which is already there only changes quantities on the path to its node
+        iterator<T> insert(const T & item);
+        iterator<T> insert(T && item);
+        template<typename... Args>
+        iterator<T> emplace(Args &&... args);
+        void remove(const T & item); // removes one copy
+        int remove_all(const T & item); // removes all copies, returns their quantity
+        int count(const T & item) const; // quantity of copies of item
+        T k_th_order_statistic(int i) const; // copies are counted
+        // every copy is saved, the snapshot is read by load or Mapped_snapshot
+        bool save(const char * path, std::uint32_t log_epoch = 0) const;
+        bool load(const char * path, std::uint32_t * log_epoch = nullptr);
+        // copies are counted by size, elem_less_than and count_in_range
+        using tree::size;
+        using tree::is_valid;
+        using tree::is_there;
+        using tree::elem_less_than;
+        using tree::count_in_range;
+        using tree::aggregate;
+        using tree::prefix_aggregate; // copies are counted by Aggregate::of(value, count)
+        using tree::range_aggregate;
+        using tree::lower_bound;
+        using tree::upper_bound;
+        using tree::equal_range;
+        using tree::min;
+        using tree::max;
+        using tree::begin;
+        using tree::end;
+        using tree::cbegin;
+        using tree::cend;
+        using tree::rbegin;
+        using tree::rend;
+        using tree::crbegin;
+        using tree::crend;
+        using tree::get_allocator;
+        using tree::key_comp;
+        using tree::set_quiet;
+        using tree::duplicates; // it is always 0, copies are not duplicates here
+#ifdef AVL_TREE_STATS
+        using tree::stats;
+#endif
+};
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_multiset<T, Compare, Allocator, Aggregate>::AVL_multiset() : tree() {}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_multiset<T, Compare, Allocator, Aggregate>::AVL_multiset(const Allocator & allocator) : tree(allocator) {}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_multiset<T, Compare, Allocator, Aggregate>::AVL_multiset(const Compare & comp, const Allocator & allocator) : tree(comp, allocator) {}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename InputIt, typename>
+AVL_multiset<T, Compare, Allocator, Aggregate>::AVL_multiset(InputIt first, InputIt last, const Compare & comp, const Allocator & allocator)
+    : tree(comp, allocator)
+{
+    assign(first, last);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename InputIt>
+void AVL_multiset<T, Compare, Allocator, Aggregate>::assign(InputIt first, InputIt last)
+{
+    std::vector<T> values(first, last);
+
+    if (!std::is_sorted(values.begin(), values.end(), this->comp_))
+    {
+        std::sort(values.begin(), values.end(), this->comp_);
+    }
+
+    // runs of equal values become nodes with counts
+    std::vector<int> counts;
+    std::size_t distinct = 0;
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        if (distinct > 0 && !this->comp_(values[distinct - 1], values[i]))
+        {
+            ++counts.back();
+        }
+        else
+        {
+            if (distinct != i)
+            {
+                values[distinct] = std::move(values[i]);
+            }
+            ++distinct;
+            counts.push_back(1);
+        }
+    }
+
+    Node<T, Aggregate> * new_root = this->build(values.data(), static_cast<int>(distinct), counts.data());
+
+    this->delete_all(this->root);
+    this->root = new_root;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_multiset<T, Compare, Allocator, Aggregate>::add_copies(Node<T, Aggregate> ** path[], int count, Node<T, Aggregate> * node, int copies)
+{
+    // the shape is the same, only quantities and values of the policy change from node up to the root
+    node->count_ += copies;
+    this->update(node);
+
+    for (int i = count - 1; i >= 0; --i)
+        this->update(*path[i]);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_multiset<T, Compare, Allocator, Aggregate>::find_node(const T & item) const
+{
+    Node<T, Aggregate> * node = this->lower_bound_node(item);
+
+    return node != nullptr && !this->comp_(item, node->value_) ? node : nullptr;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename AVL_multiset<T, Compare, Allocator, Aggregate>::template iterator<T> AVL_multiset<T, Compare, Allocator, Aggregate>::insert(const T & item)
+{
+    // links from the root to the place of the item
+    Node<T, Aggregate> ** path[tree::max_height_];
+    int count = 0;
+    Node<T, Aggregate> * parent = nullptr;
+    Node<T, Aggregate> ** link = this->find_link(item, path, count, parent);
+
+    if (*link != nullptr)
+    {
+        add_copies(path, count, *link, 1);
+
+        return this->make_iterator(*link);
+    }
+
+    return this->make_iterator(this->attach(this->create_node(item), link, parent, path, count));
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename AVL_multiset<T, Compare, Allocator, Aggregate>::template iterator<T> AVL_multiset<T, Compare, Allocator, Aggregate>::insert(T && item)
+{
+    Node<T, Aggregate> ** path[tree::max_height_];
+    int count = 0;
+    Node<T, Aggregate> * parent = nullptr;
+    Node<T, Aggregate> ** link = this->find_link(item, path, count, parent);
+
+    if (*link != nullptr)
+    {
+        add_copies(path, count, *link, 1);
+
+        return this->make_iterator(*link);
+    }
+
+    return this->make_iterator(this->attach(this->create_node(std::move(item)), link, parent, path, count));
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename... Args>
+typename AVL_multiset<T, Compare, Allocator, Aggregate>::template iterator<T> AVL_multiset<T, Compare, Allocator, Aggregate>::emplace(Args &&... args)
+{
+    Node<T, Aggregate> * item_node = this->create_node(std::forward<Args>(args)...);
+    Node<T, Aggregate> ** path[tree::max_height_];
+    int count = 0;
+    Node<T, Aggregate> * parent = nullptr;
+    Node<T, Aggregate> ** link = this->find_link(item_node->value_, path, count, parent);
+
+    if (*link != nullptr)
+    {
+        this->destroy_node(item_node);
+        add_copies(path, count, *link, 1);
+
+        return this->make_iterator(*link);
+    }
+
+    return this->make_iterator(this->attach(item_node, link, parent, path, count));
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_multiset<T, Compare, Allocator, Aggregate>::remove(const T & item)
+{
+    Node<T, Aggregate> ** path[tree::max_height_];
+    int count = 0;
+    Node<T, Aggregate> * parent = nullptr;
+    Node<T, Aggregate> ** link = this->find_link(item, path, count, parent);
+
+    if (*link == nullptr)
+    {
+        if constexpr (requires { std::cerr << item; })
+        {
+            std::cerr << "\nThere isn`t " << item << " in the tree." << std::endl;
+        }
+    }
+    else if ((*link)->count_ > 1)
+    {
+        add_copies(path, count, *link, -1);
+    }
+    else
+    {
+        // the last copy is removed with its node
+        tree::remove(&this->root, item);
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_multiset<T, Compare, Allocator, Aggregate>::remove_all(const T & item)
+{
+    Node<T, Aggregate> * node = find_node(item);
+
+    if (node == nullptr)
+    {
+        return 0;
+    }
+
+    int copies = node->count_;
+    tree::remove(&this->root, item);
+
+    return copies;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_multiset<T, Compare, Allocator, Aggregate>::count(const T & item) const
+{
+    Node<T, Aggregate> * node = find_node(item);
+
+    return node == nullptr ? 0 : node->count_;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+T AVL_multiset<T, Compare, Allocator, Aggregate>::k_th_order_statistic(int i) const
+{
+    if (i <= 0 || i > size())
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return T();
+    }
+
+    Node<T, Aggregate> * current_node = this->root;
+    AVL_STATS(++this->stats_.descents_;)
+
+    while (true)
+    {
+        AVL_STATS(++this->stats_.visited_nodes_;)
+        int left = this->elements_quantity(current_node->left_branch_);
+
+        if (i <= left)
+        {
+            current_node = current_node->left_branch_;
+        }
+        else if (i <= left + current_node->count_)
+        {
+            return current_node->value_;
+        }
+        else
+        {
+            i -= left + current_node->count_;
+            current_node = current_node->right_branch_;
+        }
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_multiset<T, Compare, Allocator, Aggregate>::save(const char * path, std::uint32_t log_epoch) const
+{
+    return save_snapshot<T>(path, copy_iterator(iterator<T>::go_to_the_left(this->root)), size(), log_epoch);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_multiset<T, Compare, Allocator, Aggregate>::load(const char * path, std::uint32_t * log_epoch)
+{
+    std::vector<T> keys;
+
+    if (!load_snapshot(path, keys, log_epoch))
+    {
+        return false;
+    }
+
+    assign(keys.begin(), keys.end());
+
+    return true;
+}
+
+#endif
@@ -3,99 +3,205 @@
 
 #include <iostream>
 #include <cmath>
-#include <stack>
-
-template<typename T>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <numeric>
+#include <span>
+#include <cstddef>
+#include <functional>
+#include "Node_Pool.h"
+#include "Frozen_AVL_Tree.h"
+#include "Snapshot.h"
+#include "Tree_Stats.h"
+#include "Aggregates.h"
+
+template<typename T, typename Aggregate = No_aggregate<T>>
 struct Node
 {
     T value_;
-    int balance_;
-    Node<T> * right_branch_;
-    Node<T> * left_branch_;
+    int height_; // height of this subtree, a leaf has height 1
+    Node<T, Aggregate> * right_branch_;
+    Node<T, Aggregate> * left_branch_;
+    Node<T, Aggregate> * parent_;
     int elements_; // quantity of elements in this subtree
-    Node()
-    {
-        value_ = 0;
-        balance_ = 0;
-        right_branch_ = nullptr;
-        left_branch_ = nullptr;
-        elements_ = 1;
-    }
-    Node(T value)
+    int count_; // copies of the value, it is always 1 in AVL_tree and can be more in AVL_multiset
+    [[no_unique_address]] typename Aggregate::value_type aggregate_; // value of the policy for this subtree
+    // the value is made in place from any arguments of its constructor
+    template<typename... Args>
+    explicit Node(std::in_place_t, Args &&... args) : value_(std::forward<Args>(args)...)
     {
-        value_ = value;
-        balance_ = 0;
+        height_ = 1;
         right_branch_ = nullptr;
         left_branch_ = nullptr;
+        parent_ = nullptr;
         elements_ = 1;
+        count_ = 1;
+        aggregate_ = Aggregate::of(value_, 1);
     }
 };
 
-template<typename T>
+template<typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>, typename Aggregate = No_aggregate<T>>
 class AVL_tree;
 
-template<typename T>
-std::ostream & operator<<(std::ostream & os, const Node<T> * node);
+template<typename T, typename Aggregate>
+std::ostream & operator<<(std::ostream & os, const Node<T, Aggregate> * node);
 
-template<typename T>
-std::ostream & operator<<(std::ostream & os, const AVL_tree<T> & tree);
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+std::ostream & operator<<(std::ostream & os, const AVL_tree<T, Compare, Allocator, Aggregate> & tree);
 
 
-template<typename T>
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
 class AVL_tree
 {
+    // AVL_multiset keeps copies of values in the same nodes
+    template<typename, typename, typename, typename>
+    friend class AVL_multiset;
     private:
-        Node<T> * root;
-        int height(const Node<T> * node) const;
-        void set_balance(Node<T> * node);
-        void L_rotate(Node<T> ** root_node);
-        void R_rotate(Node<T> ** root_node);
-        void LR_rotate(Node<T> ** root_node);
-        void RL_rotate(Node<T> ** root_node);
-        void check_and_rotate(Node<T> ** node, T item);
-        void check_and_rotate(Node<T> ** node);
-        Node<T> * create_tree(Node<T> * node);
-        void delete_all(Node<T> * & node);
-        void deep_copy(Node<T> * & current, const Node<T> * other);
-        void insert(Node<T> ** node, T item);
-        void remove(Node<T> ** node, T item);
-        T min(Node<T> * node) const; // finding min element in a branch
-        T max(Node<T> * node) const; // finding max element in a branch
-        int elements_quantity(Node<T> * node) const;
-        void show(Node<T> * node) const;
-        void print_n(const Node<T> * node, int n, int level, int prob) const;
-        void print(const Node<T> * node) const;
-        friend std::ostream & operator<< <T> (std::ostream & os, const Node<T> * node);
+        // height of an AVL tree is less than 1.45 * log2(n + 2), it is 45 for 2^31 elements
+        static const int max_height_ = 64;
+        using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node<T, Aggregate>>;
+        using node_traits = std::allocator_traits<node_allocator>;
+        Node<T, Aggregate> * root;
+        node_allocator allocator_;
+        [[no_unique_address]] Compare comp_;
+        bool quiet_; // count duplicates instead of a message about every one
+        std::size_t duplicates_;
+#ifdef AVL_TREE_STATS
+        mutable Tree_stats stats_; // queries are const, but they are counted too
+#endif
+        template<typename... Args>
+        Node<T, Aggregate> * create_node(Args &&... args); // the value is made in the node from args
+        void destroy_node(Node<T, Aggregate> * node);
+        int height(const Node<T, Aggregate> * node) const;
+        int balance(const Node<T, Aggregate> * node) const;
+        void update(Node<T, Aggregate> * node);
+        static void set_parent(Node<T, Aggregate> * node, Node<T, Aggregate> * parent);
+        void L_rotate(Node<T, Aggregate> ** root_node);
+        void R_rotate(Node<T, Aggregate> ** root_node);
+        void LR_rotate(Node<T, Aggregate> ** root_node);
+        void RL_rotate(Node<T, Aggregate> ** root_node);
+        void check_and_rotate(Node<T, Aggregate> ** node);
+        Node<T, Aggregate> * create_tree(Node<T, Aggregate> * node);
+        // perfectly balanced tree from sorted values, counts[j] is quantity of copies of values[j] if it is given
+        Node<T, Aggregate> * build(const T * values, int count, const int * counts = nullptr);
+        void sort_unique(std::vector<T> & values) const;
+        void delete_all(Node<T, Aggregate> * & node);
+        void copy_node(Node<T, Aggregate> * current, const Node<T, Aggregate> * other); // copy fields and shape of branches
+        void deep_copy(Node<T, Aggregate> * & current, const Node<T, Aggregate> * other);
+        // link where item is or where it has to be inserted, links above it are put to path
+        Node<T, Aggregate> ** find_link(const T & item, Node<T, Aggregate> ** path[], int & count, Node<T, Aggregate> * & parent);
+        Node<T, Aggregate> * attach(Node<T, Aggregate> * item_node, Node<T, Aggregate> ** link, Node<T, Aggregate> * parent, Node<T, Aggregate> ** path[], int count);
+        void count_duplicate(const T & item);
+        bool remove(Node<T, Aggregate> ** node, const T & item);
+        void rebalance_path(Node<T, Aggregate> ** path[], int count); // from the bottom of the path to the top
+        // trees for split and join have no parent, they and their results are balanced
+        Node<T, Aggregate> * join(Node<T, Aggregate> * left, Node<T, Aggregate> * middle, Node<T, Aggregate> * right); // left < middle < right
+        Node<T, Aggregate> * join(Node<T, Aggregate> * left, Node<T, Aggregate> * right); // left < right
+        void split(Node<T, Aggregate> * node, const T & item, Node<T, Aggregate> * & less, Node<T, Aggregate> * & not_less); // by value of item
+        void split_rank(Node<T, Aggregate> * node, int k, Node<T, Aggregate> * & first, Node<T, Aggregate> * & rest); // the first k elements
+        void split_path(Node<T, Aggregate> * nodes[], const bool to_first[], int count, Node<T, Aggregate> * & first, Node<T, Aggregate> * & rest);
+        Node<T, Aggregate> * detach_min(Node<T, Aggregate> ** node); // take the min node out of a branch
+        Node<T, Aggregate> * detach_max(Node<T, Aggregate> ** node); // take the max node out of a branch
+        Node<T, Aggregate> * unite(Node<T, Aggregate> * left, Node<T, Aggregate> * right); // union of trees, equal nodes of right are deleted
+        const T & min(Node<T, Aggregate> * node) const; // finding min element in a branch
+        const T & max(Node<T, Aggregate> * node) const; // finding max element in a branch
+        int elements_quantity(Node<T, Aggregate> * node) const;
+        // invariants of a branch, its values have to be between low and high if they are given
+        bool is_valid(const Node<T, Aggregate> * node, const Node<T, Aggregate> * parent, const T * low, const T * high) const;
+        static typename Aggregate::value_type aggregate_of(const Node<T, Aggregate> * node); // value of the policy for a branch
+        // descents for keys of T and for other keys of a transparent comparator
+        template<typename K>
+        bool find_key(const K & item) const;
+        template<typename K>
+        int count_less(const K & item) const;
+        template<typename K>
+        Node<T, Aggregate> * lower_bound_node(const K & item) const;
+        template<typename K>
+        Node<T, Aggregate> * upper_bound_node(const K & item) const;
+        void show(Node<T, Aggregate> * node) const;
+        void print_n(const Node<T, Aggregate> * node, int n, int level, int prob) const;
+        void print(const Node<T, Aggregate> * node) const;
+        friend std::ostream & operator<< <T, Aggregate> (std::ostream & os, const Node<T, Aggregate> * node);
     public:
         AVL_tree();
-        AVL_tree(const AVL_tree<T> & tree);
-        AVL_tree(AVL_tree<T> && tree);
+        explicit AVL_tree(const Allocator & allocator);
+        explicit AVL_tree(const Compare & comp, const Allocator & allocator = Allocator());
+        template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        AVL_tree(InputIt first, InputIt last, const Allocator & allocator = Allocator());
+        template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        AVL_tree(InputIt first, InputIt last, const Compare & comp, const Allocator & allocator = Allocator());
+        AVL_tree(const AVL_tree<T, Compare, Allocator, Aggregate> & tree);
+        AVL_tree(AVL_tree<T, Compare, Allocator, Aggregate> && tree);
         ~AVL_tree();
-        AVL_tree<T> & operator=(const AVL_tree<T> & tree);
-        AVL_tree<T> & operator=(AVL_tree<T> && tree);
-        bool is_there(T item) const;
-        void insert(T item);
-        void remove(T item);
+        AVL_tree<T, Compare, Allocator, Aggregate> & operator=(const AVL_tree<T, Compare, Allocator, Aggregate> & tree);
+        AVL_tree<T, Compare, Allocator, Aggregate> & operator=(AVL_tree<T, Compare, Allocator, Aggregate> && tree);
+        bool is_there(const T & item) const;
+        // keys of other types are compared with elements if Compare has is_transparent, like std::less<>
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        bool is_there(const K & item) const;
+        void remove(const T & item);
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last); // replace all elements, it takes O(n) for sorted values
         int size() const;
+        bool is_valid() const; // heights, balance, quantities, parent links and order of all nodes, it takes O(n)
+        Allocator get_allocator() const;
+        Compare key_comp() const;
         void show() const;
         void print() const;
+        void set_quiet(bool quiet);
+        std::size_t duplicates() const; // quantity of values which were already in the tree
+#ifdef AVL_TREE_STATS
+        Tree_stats stats() const; // counters of rotations and descents, size and height of the tree
+#endif
         T k_th_order_statistic(int i) const;
-        int elem_less_than(T item) const;
+        int elem_less_than(const T & item) const;
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        int elem_less_than(const K & item) const;
+        // answers for all queries by one traversal, results[j] is the answer for the query j
+        void k_th_batch(std::span<const int> ranks, std::span<T> results) const;
+        void elem_less_than_batch(std::span<const T> items, std::span<int> results) const;
+        // bulk removal by split and join, it takes O(log n + k) for k removed elements
+        int erase_range(const T & first, const T & last); // removes elements in [first, last), returns their quantity
+        // values of the Aggregate policy, like sums of elements, they take O(log n)
+        typename Aggregate::value_type aggregate() const; // of all elements, it takes O(1)
+        typename Aggregate::value_type prefix_aggregate(const T & item) const; // of elements less than item
+        typename Aggregate::value_type range_aggregate(const T & first, const T & last) const; // of elements in [first, last)
+        typename Aggregate::value_type rank_aggregate(int first, int last) const; // of k-th order statistics for k from first to last
+        int erase_rank_range(int first, int last); // removes k-th order statistics for k from first to last
+        T pop_min(); // removes the min element and returns it
+        T pop_max(); // removes the max element and returns it
+        // moving of nodes between trees, the trees become empty
+        std::pair<AVL_tree<T, Compare, Allocator, Aggregate>, AVL_tree<T, Compare, Allocator, Aggregate>> split(const T & item); // elements less than item and the rest
+        void join(AVL_tree<T, Compare, Allocator, Aggregate> && tree); // O(log n) if all elements of tree are greater
+        void merge(AVL_tree<T, Compare, Allocator, Aggregate> && tree); // union, O(m log(n / m + 1)) for m elements in the smaller tree
         T min() const; // finding min element in a tree
         T max() const; // finding max element in a tree
-        friend std::ostream & operator<< <T> (std::ostream & os, const AVL_tree<T> & tree);
+        Frozen_AVL_tree<T, Compare> freeze() const; // read-only snapshot for fast queries
+        // binary snapshot, it can be read by load or Mapped_snapshot, log_epoch is kept for Write_ahead_log
+        bool save(const char * path, std::uint32_t log_epoch = 0) const;
+        bool load(const char * path, std::uint32_t * log_epoch = nullptr); // replace all elements by a snapshot, it takes O(n)
+        friend std::ostream & operator<< <T, Compare, Allocator, Aggregate> (std::ostream & os, const AVL_tree<T, Compare, Allocator, Aggregate> & tree);
 
+        // bidirectional iterator, it goes by parent pointers and does not allocate memory
         template<typename E>
         class iterator
         {
             friend class AVL_tree;
+            template<typename, typename, typename, typename>
+            friend class AVL_multiset;
             private:
-                std::stack<Node<E> *> stack_;
-                Node<E> * root_;
-                Node<E> * current_;
-                int iteration_complete_; // flag is iterator in the end of the container
+                Node<E, Aggregate> * const * root_; // root of the tree, it is needed to step back from the end
+                Node<E, Aggregate> * current_; // nullptr is the end of the container
                 bool direction_flag_;
-                Node<E> * go_to_the_left(Node<E> * node)
+                iterator(Node<E, Aggregate> * const * root, Node<E, Aggregate> * current, bool direction_flag) : root_(root),
+                                                                                         current_(current),
+                                                                                         direction_flag_(direction_flag) {}
+                static Node<E, Aggregate> * go_to_the_left(Node<E, Aggregate> * node)
                 {
                     if (node == nullptr)
                     {
@@ -103,12 +209,11 @@ class AVL_tree
                     }
                     while(node->left_branch_ != nullptr)
                     {
-                        stack_.push(node);
                         node = node->left_branch_;
                     }
                     return node;
                 }
-                Node<E> * go_to_the_right(Node<E> * node)
+                static Node<E, Aggregate> * go_to_the_right(Node<E, Aggregate> * node)
                 {
                     if (node == nullptr)
                     {
@@ -116,59 +221,53 @@ class AVL_tree
                     }
                     while(node->right_branch_ != nullptr)
                     {
-                        stack_.push(node);
                         node = node->right_branch_;
                     }
                     return node;
                 }
-            public:
-                iterator(const iterator<E> & it) : stack_(it.stack_),
-                                                   root_(it.root_),
-                                                   current_(it.current_),
-                                                   iteration_complete_(it.iteration_complete_),
-                                                   direction_flag_(it.direction_flag_) {}
-                iterator()
-                {
-                    stack_;
-                    root_ = nullptr;
-                    current_ = nullptr;
-                    iteration_complete_ = 1;
-                    direction_flag_ = 1;
-                }
-                iterator(iterator<E> && it)
-                {
-                    std::swap(stack_, it.stack_);
-                    std::swap(root_, it.root_);
-                    std::swap(current_, it.current_);
-                    std::swap(iteration_complete_, it.iteration_complete_);
-                    std::swap(direction_flag_, it.direction_flag_);
-                }
-                iterator<E> & operator=(const iterator<E> & it)
+                static Node<E, Aggregate> * next(Node<E, Aggregate> * node)
                 {
-                    if (this != &it)
+                    if (node->right_branch_ != nullptr)
                     {
-                        stack_ = it.stack_;
-                        root_ = it.root_;
-                        current_ = it.current_;
-                        iteration_complete_ = it.iteration_complete_;
-                        direction_flag_ = it.direction_flag_;
+                        return go_to_the_left(node->right_branch_);
                     }
 
-                    return *this;
+                    // go up while the node is a right child
+                    Node<E, Aggregate> * parent = node->parent_;
+
+                    while (parent != nullptr && parent->right_branch_ == node)
+                    {
+                        node = parent;
+                        parent = parent->parent_;
+                    }
+                    return parent;
                 }
-                iterator<E> & operator=(iterator<E> && it)
+                static Node<E, Aggregate> * previous(Node<E, Aggregate> * node)
                 {
-                    if (this != &it)
+                    if (node->left_branch_ != nullptr)
                     {
-                        std::swap(stack_, it.stack_);
-                        std::swap(root_, it.root_);
-                        std::swap(current_, it.current_);
-                        std::swap(iteration_complete_, it.iteration_complete_);
-                        std::swap(direction_flag_, it.direction_flag_);
+                        return go_to_the_right(node->left_branch_);
                     }
 
-                    return *this;
+                    // go up while the node is a left child
+                    Node<E, Aggregate> * parent = node->parent_;
+
+                    while (parent != nullptr && parent->left_branch_ == node)
+                    {
+                        node = parent;
+                        parent = parent->parent_;
+                    }
+                    return parent;
                 }
+            public:
+                using iterator_category = std::bidirectional_iterator_tag;
+                using value_type = E;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const E *;
+                using reference = const E &;
+                iterator() : root_(nullptr),
+                             current_(nullptr),
+                             direction_flag_(true) {}
                 const E & operator*() const
                 {
                     if (current_ == nullptr)
@@ -178,6 +277,10 @@ class AVL_tree
                     }
                     return current_->value_;
                 }
+                const E * operator->() const
+                {
+                    return &**this;
+                }
                 bool operator==(const iterator<E> & it) const
                 {
                     if (direction_flag_ == it.direction_flag_) // if there are iterators with the same direction
@@ -208,392 +311,651 @@ class AVL_tree
                 }
                 iterator<E> & operator++()
                 {
-                    if (iteration_complete_ == 1)
+                    // the end stays the end
+                    if (current_ != nullptr)
                     {
-                        std::cerr << "Next: iterator has gone the end of the container" << std::endl;
-                        exit(1);
+                        current_ = direction_flag_ ? next(current_) : previous(current_);
                     }
 
-                    if (direction_flag_ == true)
+                    return *this;
+                }
+                iterator<E> operator++(int)
+                {
+                    auto it = *this;
+                    ++(*this);
+
+                    return it;
+                }
+                iterator<E> & operator--()
+                {
+                    // the end goes to the last element
+                    if (current_ == nullptr)
                     {
-                        if (current_->right_branch_ != nullptr)
-                        {
-                            current_ = go_to_the_left(current_->right_branch_);
-                        }
-                        else if (!stack_.empty())
-                        {
-                            current_ = stack_.top();
-                            stack_.pop();
-                        }
-                        else
+                        if (root_ != nullptr)
                         {
-                            current_ = nullptr;
-                            iteration_complete_ = 1;
+                            current_ = direction_flag_ ? go_to_the_right(*root_) : go_to_the_left(*root_);
                         }
                     }
                     else
                     {
-                        if (current_->left_branch_ != nullptr)
-                        {
-                            current_ = go_to_the_right(current_->left_branch_);
-                        }
-                        else if (!stack_.empty())
-                        {
-                            current_ = stack_.top();
-                            stack_.pop();
-                        }
-                        else
+                        Node<E, Aggregate> * node = direction_flag_ ? previous(current_) : next(current_);
+
+                        // the first element stays the first
+                        if (node != nullptr)
                         {
-                            current_ = nullptr;
-                            iteration_complete_ = 1;
+                            current_ = node;
                         }
                     }
 
                     return *this;
                 }
-                iterator<E> operator++(int)
+                iterator<E> operator--(int)
                 {
                     auto it = *this;
-                    ++(*this);
+                    --(*this);
 
                     return it;
                 }
         };
+        // single descent: the iterator points to the new element or to the element which was already there
+        std::pair<iterator<T>, bool> insert(const T & item);
+        std::pair<iterator<T>, bool> insert(T && item);
+        // the value is made in a new node, the node is freed if the value is already in the tree
+        template<typename... Args>
+        std::pair<iterator<T>, bool> emplace(Args &&... args);
+        // iterators to any key, a scan of k keys from there takes O(log n + k)
+        iterator<T> lower_bound(const T & item) const; // the first element which is not less than item
+        iterator<T> upper_bound(const T & item) const; // the first element which is greater than item
+        std::pair<iterator<T>, iterator<T>> equal_range(const T & item) const;
+        int count_in_range(const T & first, const T & last) const; // quantity of elements in [first, last)
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        iterator<T> lower_bound(const K & item) const;
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        iterator<T> upper_bound(const K & item) const;
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        std::pair<iterator<T>, iterator<T>> equal_range(const K & item) const;
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        int count_in_range(const K & first, const K & last) const;
         iterator<T> begin() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = root;
-            while(it.current_->left_branch_ != nullptr)
-            {
-                it.stack_.push(it.current_);
-                it.current_ = it.current_->left_branch_;
-            }
-
-            it.iteration_complete_ = 0;
-            it.direction_flag_ = true; // from min to max
-
-            return it;
+            return iterator<T>(&root, iterator<T>::go_to_the_left(root), true); // from min to max
         }
         iterator<T> end() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = nullptr;
-            it.iteration_complete_ = 1;
-            it.direction_flag_ = true; // from min to max
-
-            return it;
+            return iterator<T>(&root, nullptr, true); // from min to max
         }
         iterator<T> cbegin() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = root;
-            while(it.current_->left_branch_ != nullptr)
-            {
-                it.stack_.push(it.current_);
-                it.current_ = it.current_->left_branch_;
-            }
-
-            it.iteration_complete_ = 0;
-            it.direction_flag_ = true; // from min to max
-
-            return it;
+            return iterator<T>(&root, iterator<T>::go_to_the_left(root), true); // from min to max
         }
         iterator<T> cend() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = nullptr;
-            it.iteration_complete_ = 1;
-            it.direction_flag_ = true; // from min to max
-
-            return it;
+            return iterator<T>(&root, nullptr, true); // from min to max
         }
-        //////////////// ОБРАТНО
         iterator<T> rbegin() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = root;
-            while(it.current_->right_branch_ != nullptr)
-            {
-                it.stack_.push(it.current_);
-                it.current_ = it.current_->right_branch_;
-            }
-
-            it.iteration_complete_ = 0;
-            it.direction_flag_ = false; // from max to min
-
-            return it;
+            return iterator<T>(&root, iterator<T>::go_to_the_right(root), false); // from max to min
         }
         iterator<T> rend() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = nullptr;
-            it.iteration_complete_ = 1;
-            it.direction_flag_ = false; // from max to min
-
-            return it;
+            return iterator<T>(&root, nullptr, false); // from max to min
         }
         iterator<T> crbegin() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = root;
-            while(it.current_->right_branch_ != nullptr)
-            {
-                it.stack_.push(it.current_);
-                it.current_ = it.current_->right_branch_;
-            }
-
-            it.iteration_complete_ = 0;
-            it.direction_flag_ = false; // from max to min
-
-            return it;
+            return iterator<T>(&root, iterator<T>::go_to_the_right(root), false); // from max to min
         }
         iterator<T> crend() const
         {
-            iterator<T> it;
-
-            it.root_ = root;
-            it.current_ = nullptr;
-            it.iteration_complete_ = 1;
-            it.direction_flag_ = false; // from max to min
-
-            return it;
+            return iterator<T>(&root, nullptr, false); // from max to min
+        }
+    private:
+        iterator<T> make_iterator(Node<T, Aggregate> * node) const
+        {
+            return iterator<T>(&root, node, true); // from min to max
         }
 };
 
-template<typename T>
-void AVL_tree<T>::deep_copy(Node<T> * & current, const Node<T> * other)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::copy_node(Node<T, Aggregate> * current, const Node<T, Aggregate> * other)
 {
-    if (current != nullptr && other != nullptr)
-        {
-            current->value_ = other->value_;
-            current->balance_ = other->balance_;
-            deep_copy(current->left_branch_, other->left_branch_);
-            deep_copy(current->right_branch_,other->right_branch_);
-            current->elements_ = other->elements_;
-        }
-    else if (current != nullptr && other == nullptr)
+    current->value_ = other->value_;
+    current->height_ = other->height_;
+    current->elements_ = other->elements_;
+    current->count_ = other->count_;
+    current->aggregate_ = other->aggregate_;
+
+    // branches which other does not have are deleted, missing branches are created
+    if (other->left_branch_ == nullptr)
+    {
+        delete_all(current->left_branch_);
+    }
+    else if (current->left_branch_ == nullptr)
+    {
+        current->left_branch_ = create_node(other->left_branch_->value_);
+        current->left_branch_->parent_ = current;
+    }
+
+    if (other->right_branch_ == nullptr)
+    {
+        delete_all(current->right_branch_);
+    }
+    else if (current->right_branch_ == nullptr)
+    {
+        current->right_branch_ = create_node(other->right_branch_->value_);
+        current->right_branch_->parent_ = current;
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::deep_copy(Node<T, Aggregate> * & current, const Node<T, Aggregate> * other)
+{
+    if (other == nullptr)
     {
         delete_all(current);
+        return;
+    }
+
+    if (current == nullptr)
+    {
+        current = create_node(other->value_);
     }
-    else if (current == nullptr && other != nullptr)
+
+    // both trees are walked together by parent pointers, nodes of current are reused
+    Node<T, Aggregate> * current_node = current;
+    const Node<T, Aggregate> * other_node = other;
+    const Node<T, Aggregate> * came_from = nullptr; // branch of other_node which was just copied
+
+    copy_node(current_node, other_node);
+
+    while (true)
     {
-        current = new Node<T>;
-        current->value_ = other->value_;
-        current->balance_ = other->balance_;
-        deep_copy(current->left_branch_, other->left_branch_);
-        deep_copy(current->right_branch_, other->right_branch_);
-        current->elements_ = other->elements_;
+        if (came_from == nullptr && other_node->left_branch_ != nullptr)
+        {
+            current_node = current_node->left_branch_;
+            other_node = other_node->left_branch_;
+            copy_node(current_node, other_node);
+        }
+        else if (other_node->right_branch_ != nullptr && came_from != other_node->right_branch_)
+        {
+            current_node = current_node->right_branch_;
+            other_node = other_node->right_branch_;
+            copy_node(current_node, other_node);
+            came_from = nullptr;
+        }
+        else if (other_node == other)
+        {
+            break;
+        }
+        else
+        {
+            came_from = other_node;
+            current_node = current_node->parent_;
+            other_node = other_node->parent_;
+        }
     }
 }
-template<typename T>
-AVL_tree<T>::AVL_tree()
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate>::AVL_tree()
+{
+    root = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate>::AVL_tree(const Allocator & allocator) : allocator_(allocator)
+{
+    root = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate>::AVL_tree(const Compare & comp, const Allocator & allocator) : allocator_(allocator),
+                                                                                              comp_(comp)
 {
     root = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
 }
 
-template<typename T>
-Node<T> * AVL_tree<T>::create_tree(Node<T> * node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename... Args>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::create_node(Args &&... args)
 {
-    if (node == nullptr) return nullptr;
+    Node<T, Aggregate> * node = node_traits::allocate(allocator_, 1);
 
-    Node<T> * new_node = new Node<T>(node->value_);
+    try
+    {
+        node_traits::construct(allocator_, node, std::in_place, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        node_traits::deallocate(allocator_, node, 1);
+        throw;
+    }
+
+    return node;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::destroy_node(Node<T, Aggregate> * node)
+{
+    node_traits::destroy(allocator_, node);
+    node_traits::deallocate(allocator_, node, 1);
+}
 
-    if (node->left_branch_ != nullptr)
-        new_node->left_branch_ = create_tree(node->left_branch_);
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::create_tree(Node<T, Aggregate> * node)
+{
+    Node<T, Aggregate> * new_node = nullptr;
 
-    if (node->right_branch_ != nullptr)
-        new_node->right_branch_ = create_tree(node->right_branch_);
+    deep_copy(new_node, node);
 
     return new_node;
 }
 
-template<typename T>
-AVL_tree<T>::AVL_tree(const AVL_tree<T> & tree)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::build(const T * values, int count, const int * counts)
 {
-    root = create_tree(tree.root);
+    if (count == 0) return nullptr;
+
+    //  values[0] ... values[middle - 1]  values[middle]  values[middle + 1] ... values[count - 1]
+    //           left_branch                   node                  right_branch
+    int middle = count / 2;
+    Node<T, Aggregate> * node = create_node(values[middle]);
+
+    if (counts != nullptr)
+    {
+        node->count_ = counts[middle];
+    }
+
+    node->left_branch_ = build(values, middle, counts);
+    node->right_branch_ = build(values + middle + 1, count - middle - 1, counts == nullptr ? nullptr : counts + middle + 1);
+    set_parent(node->left_branch_, node);
+    set_parent(node->right_branch_, node);
+    update(node);
+
+    return node;
 }
 
-template<typename T>
-AVL_tree<T>::AVL_tree(AVL_tree<T> && tree) : root(tree.root)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::sort_unique(std::vector<T> & values) const
 {
-    tree.root = nullptr;
+    const Compare & comp = comp_;
+    auto not_less = [&comp](const T & left, const T & right) { return !comp(left, right); };
+
+    // values are already sorted without duplicates
+    if (std::adjacent_find(values.begin(), values.end(), not_less) == values.end())
+    {
+        return;
+    }
+
+    const std::size_t min_part_size = 1 << 16;
+    std::size_t parts = std::thread::hardware_concurrency();
+
+    if (parts > values.size() / min_part_size)
+    {
+        parts = values.size() / min_part_size;
+    }
+
+    if (parts <= 1)
+    {
+        std::sort(values.begin(), values.end(), comp);
+    }
+    else
+    {
+        // sort parts in different threads, then merge neighbouring parts in pairs
+        std::vector<std::size_t> bounds;
+        for (std::size_t i = 0; i <= parts; ++i)
+            bounds.push_back(values.size() * i / parts);
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < parts; ++i)
+            threads.emplace_back([&values, &bounds, &comp, i]() { std::sort(values.begin() + bounds[i], values.begin() + bounds[i + 1], comp); });
+        for (std::thread & thread : threads)
+            thread.join();
+
+        for (std::size_t step = 1; step < parts; step *= 2)
+        {
+            threads.clear();
+            for (std::size_t i = 0; i + step < parts; i += 2 * step)
+            {
+                std::size_t first = bounds[i];
+                std::size_t middle = bounds[i + step];
+                std::size_t last = bounds[std::min(i + 2 * step, parts)];
+
+                threads.emplace_back([&values, &comp, first, middle, last]()
+                {
+                    std::inplace_merge(values.begin() + first, values.begin() + middle, values.begin() + last, comp);
+                });
+            }
+            for (std::thread & thread : threads)
+                thread.join();
+        }
+    }
+
+    values.erase(std::unique(values.begin(), values.end(), not_less), values.end());
 }
 
-template<typename T>
-void AVL_tree<T>::delete_all(Node<T> * & node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename InputIt, typename>
+AVL_tree<T, Compare, Allocator, Aggregate>::AVL_tree(InputIt first, InputIt last, const Allocator & allocator) : allocator_(allocator)
 {
-    if (node != nullptr)
+    root = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
+    assign(first, last);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename InputIt, typename>
+AVL_tree<T, Compare, Allocator, Aggregate>::AVL_tree(InputIt first, InputIt last, const Compare & comp, const Allocator & allocator)
+    : allocator_(allocator),
+      comp_(comp)
+{
+    root = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
+    assign(first, last);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename InputIt>
+void AVL_tree<T, Compare, Allocator, Aggregate>::assign(InputIt first, InputIt last)
+{
+    std::vector<T> values(first, last);
+
+    sort_unique(values);
+
+    Node<T, Aggregate> * new_root = build(values.data(), static_cast<int>(values.size()));
+
+    delete_all(root);
+    root = new_root;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate>::AVL_tree(const AVL_tree<T, Compare, Allocator, Aggregate> & tree)
+    : allocator_(node_traits::select_on_container_copy_construction(tree.allocator_)),
+      comp_(tree.comp_)
+{
+    root = create_tree(tree.root);
+    quiet_ = tree.quiet_;
+    duplicates_ = 0;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate>::AVL_tree(AVL_tree<T, Compare, Allocator, Aggregate> && tree) : root(tree.root),
+                                                                                     allocator_(std::move(tree.allocator_)),
+                                                                                     comp_(tree.comp_),
+                                                                                     quiet_(tree.quiet_),
+                                                                                     duplicates_(tree.duplicates_)
+{
+    tree.root = nullptr;
+
+    if constexpr (is_node_pool<node_allocator>::value)
     {
-        Node<T> * l_branch = node->left_branch_;
-        Node<T> * r_branch = node->right_branch_;
+        // the empty tree does not share the arena, so this tree can free it at once
+        tree.allocator_ = node_allocator();
+    }
+}
 
-        delete node;
-        node = nullptr;
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::delete_all(Node<T, Aggregate> * & node)
+{
+    Node<T, Aggregate> * current_node = node;
 
-        delete_all(l_branch);
-        delete_all(r_branch);
+    while (current_node != nullptr)
+    {
+        if (current_node->left_branch_ != nullptr)
+        {
+            // rotate the left branch up, so the tree becomes a list of right branches
+            Node<T, Aggregate> * l_branch = current_node->left_branch_;
+            current_node->left_branch_ = l_branch->right_branch_;
+            l_branch->right_branch_ = current_node;
+            current_node = l_branch;
+        }
+        else
+        {
+            Node<T, Aggregate> * r_branch = current_node->right_branch_;
+            destroy_node(current_node);
+            current_node = r_branch;
+        }
     }
+
+    node = nullptr;
 }
 
-template<typename T>
-AVL_tree<T>::~AVL_tree()
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate>::~AVL_tree()
 {
+    if constexpr (is_node_pool<node_allocator>::value && std::is_trivially_destructible<Node<T, Aggregate>>::value)
+    {
+        // nodes need no destructors, so blocks of the pool are freed without visiting nodes
+        if (allocator_.release())
+        {
+            root = nullptr;
+            return;
+        }
+    }
+
     delete_all(root);
 }
 
-template<typename T>
-AVL_tree<T> & AVL_tree<T>::operator=(const AVL_tree<T> & tree)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate> & AVL_tree<T, Compare, Allocator, Aggregate>::operator=(const AVL_tree<T, Compare, Allocator, Aggregate> & tree)
 {
     if (this != &tree)
     {
-        deep_copy(this->root, const_cast<const Node<T> *>(tree.root));
+        comp_ = tree.comp_;
+
+        if constexpr (node_traits::propagate_on_container_copy_assignment::value)
+        {
+            if (allocator_ != tree.allocator_)
+            {
+                delete_all(root);
+            }
+            allocator_ = tree.allocator_;
+        }
+
+        deep_copy(this->root, const_cast<const Node<T, Aggregate> *>(tree.root));
     }
 
     return *this;
 }
 
-template<typename T>
-AVL_tree<T> & AVL_tree<T>::operator=(AVL_tree<T> && tree)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+AVL_tree<T, Compare, Allocator, Aggregate> & AVL_tree<T, Compare, Allocator, Aggregate>::operator=(AVL_tree<T, Compare, Allocator, Aggregate> && tree)
 {
-    delete_all(root);
+    if (this == &tree)
+    {
+        return *this;
+    }
+
+    comp_ = tree.comp_;
+
+    if constexpr (node_traits::propagate_on_container_move_assignment::value)
+    {
+        delete_all(root);
+        allocator_ = std::move(tree.allocator_);
+
+        if constexpr (is_node_pool<node_allocator>::value)
+        {
+            tree.allocator_ = node_allocator();
+        }
+    }
+    else if (allocator_ != tree.allocator_)
+    {
+        // nodes of the other tree can not be freed by this allocator
+        deep_copy(root, const_cast<const Node<T, Aggregate> *>(tree.root));
+        return *this;
+    }
+    else
+    {
+        delete_all(root);
+    }
+
     root = tree.root;
     tree.root = nullptr;
 
     return *this;
 }
 
-template<typename T>
-bool AVL_tree<T>::is_there(T item) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::find_key(const K & item) const
 {
-    Node<T> * current_node = root;
+    Node<T, Aggregate> * current_node = root;
+    AVL_STATS(++stats_.descents_;)
 
     while(current_node != nullptr)
     {
-        if (current_node->value_ == item)
+        AVL_STATS(++stats_.visited_nodes_;)
+
+        if (comp_(current_node->value_, item))
         {
-            return true;
+            current_node = current_node->right_branch_;
         }
-        else if (current_node->value_ < item)
+        else if (comp_(item, current_node->value_))
         {
-            current_node = current_node->right_branch_;
+            current_node = current_node->left_branch_;
         }
         else
         {
-            current_node = current_node->left_branch_;
+            return true;
         }
     }
     return false;
 }
 
-template<typename T>
-int AVL_tree<T>::height(const Node<T> * node) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::is_there(const T & item) const
+{
+    return find_key(item);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K, typename C, typename>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::is_there(const K & item) const
+{
+    return find_key(item);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::height(const Node<T, Aggregate> * node) const
 {
     if (node == nullptr)
     {
         return 0;
     }
+    return node->height_;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::balance(const Node<T, Aggregate> * node) const
+{
+    return height(node->right_branch_) - height(node->left_branch_); // always right_branch - left_branch
+}
 
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::update(Node<T, Aggregate> * node)
+{
+    // branches of the node are already correct, so it takes O(1)
     int right_height = height(node->right_branch_);
     int left_height = height(node->left_branch_);
 
-    if (right_height >= left_height)
-    {
-        return right_height + 1;
-    }
-    else
-    {
-        return left_height + 1;
-    }
+    node->height_ = (right_height >= left_height ? right_height : left_height) + 1;
+    node->elements_ = elements_quantity(node->left_branch_) +
+                      elements_quantity(node->right_branch_) + node->count_;
+    node->aggregate_ = Aggregate::combine(Aggregate::combine(aggregate_of(node->left_branch_), Aggregate::of(node->value_, node->count_)),
+                                          aggregate_of(node->right_branch_));
 }
 
-template<typename T>
-void AVL_tree<T>::set_balance(Node<T> * node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::set_parent(Node<T, Aggregate> * node, Node<T, Aggregate> * parent)
 {
     if (node != nullptr)
     {
-        node->balance_ = abs(height(node->right_branch_) - height(node->left_branch_)); // always right_branch - left_branch
+        node->parent_ = parent;
     }
 }
 
-template<typename T>
-void AVL_tree<T>::L_rotate(Node<T> ** root_node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::L_rotate(Node<T, Aggregate> ** root_node)
 {
+    AVL_STATS(++stats_.l_rotations_;)
+
     //        A                     B
     //      /   \                 /   \
     //    L      B     ---->    A      R
     //         /   \          /  \
     //       C      R        L    C
 
-    Node<T> * right_branch = (*root_node)->right_branch_;
-    Node<T> * left_subtree_of_right_branch = (*root_node)->right_branch_->left_branch_;
+    Node<T, Aggregate> * right_branch = (*root_node)->right_branch_;
+    Node<T, Aggregate> * left_subtree_of_right_branch = (*root_node)->right_branch_->left_branch_;
+
+    right_branch->parent_ = (*root_node)->parent_;
+    (*root_node)->parent_ = right_branch;
+    set_parent(left_subtree_of_right_branch, *root_node);
 
     (*root_node)->right_branch_->left_branch_ = *root_node;
     (*root_node)->right_branch_ = left_subtree_of_right_branch;
     *root_node = right_branch;
 
-    // change quantity of elements after rotate
-    (*root_node)->left_branch_->elements_ = elements_quantity((*root_node)->left_branch_->left_branch_) +
-                                            elements_quantity((*root_node)->left_branch_->right_branch_) + 1;
-    (*root_node)->elements_ = elements_quantity((*root_node)->left_branch_) +
-                              elements_quantity((*root_node)->right_branch_) + 1;
-    // change balances after rotate
-    set_balance((*root_node)->left_branch_);
-    set_balance(*root_node);
+    // change heights and quantity of elements after rotate
+    update((*root_node)->left_branch_);
+    update(*root_node);
 }
 
-template<typename T>
-void AVL_tree<T>::R_rotate(Node<T> ** root_node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::R_rotate(Node<T, Aggregate> ** root_node)
 {
+    AVL_STATS(++stats_.r_rotations_;)
+
     //            A                     B
     //          /   \                 /   \
     //        B      R     ---->    L      A
     //      /   \                        /  \
     //    L      C                      C    R
-    Node<T> * left_branch = (*root_node)->left_branch_;
-    Node<T> * right_subtree_of_left_branch = (*root_node)->left_branch_->right_branch_;
+    Node<T, Aggregate> * left_branch = (*root_node)->left_branch_;
+    Node<T, Aggregate> * right_subtree_of_left_branch = (*root_node)->left_branch_->right_branch_;
+
+    left_branch->parent_ = (*root_node)->parent_;
+    (*root_node)->parent_ = left_branch;
+    set_parent(right_subtree_of_left_branch, *root_node);
 
     (*root_node)->left_branch_->right_branch_ = *root_node;
     (*root_node)->left_branch_ = right_subtree_of_left_branch;
     *root_node = left_branch;
 
-    // change quantity of elements after rotate
-    (*root_node)->right_branch_->elements_ = elements_quantity((*root_node)->right_branch_->left_branch_) +
-                                             elements_quantity((*root_node)->right_branch_->right_branch_) + 1;
-    (*root_node)->elements_ = elements_quantity((*root_node)->left_branch_) +
-                              elements_quantity((*root_node)->right_branch_) + 1;
-    // change balances after rotate
-    set_balance((*root_node)->right_branch_);
-    set_balance(*root_node);
+    // change heights and quantity of elements after rotate
+    update((*root_node)->right_branch_);
+    update(*root_node);
 }
 
-template<typename T>
-void AVL_tree<T>::LR_rotate(Node<T> ** root_node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::LR_rotate(Node<T, Aggregate> ** root_node)
 {
+    AVL_STATS(++stats_.lr_rotations_;)
+
     // combination of small L_rotate for B and R_rotate for A
-    //        A                     B
+    //        A                     C
     //      /   \                 /   \
-    //    B      R    ---->     C      A
+    //    B      R    ---->     B      A
     //  /   \                 /  \    / \
     // L     C               L    M  N   R
     //      / \
     //    M    N
-    Node<T> * last_root_node = *root_node;
-    Node<T> * left_branch = (*root_node)->left_branch_;
-    Node<T> * right_subtree_of_left_branch = left_branch->right_branch_;
+    Node<T, Aggregate> * last_root_node = *root_node;
+    Node<T, Aggregate> * left_branch = (*root_node)->left_branch_;
+    Node<T, Aggregate> * right_subtree_of_left_branch = left_branch->right_branch_;
+
+    right_subtree_of_left_branch->parent_ = last_root_node->parent_;
+    left_branch->parent_ = right_subtree_of_left_branch;
+    last_root_node->parent_ = right_subtree_of_left_branch;
+    set_parent(right_subtree_of_left_branch->left_branch_, left_branch);
+    set_parent(right_subtree_of_left_branch->right_branch_, last_root_node);
 
     left_branch->right_branch_ = right_subtree_of_left_branch->left_branch_;
     last_root_node->left_branch_ = right_subtree_of_left_branch->right_branch_;
@@ -601,22 +963,17 @@ void AVL_tree<T>::LR_rotate(Node<T> ** root_node)
     right_subtree_of_left_branch->right_branch_ = last_root_node;
     *root_node = right_subtree_of_left_branch;
 
-    // change quantity of elements after rotate
-    (*root_node)->left_branch_->elements_ = elements_quantity((*root_node)->left_branch_->left_branch_) +
-                                            elements_quantity((*root_node)->left_branch_->right_branch_) + 1;
-    (*root_node)->right_branch_->elements_ = elements_quantity((*root_node)->right_branch_->left_branch_) +
-                                             elements_quantity((*root_node)->right_branch_->right_branch_) + 1;
-    (*root_node)->elements_ = elements_quantity((*root_node)->left_branch_) +
-                              elements_quantity((*root_node)->right_branch_) + 1;
-    // change balances after rotate
-    set_balance((*root_node)->left_branch_);
-    set_balance((*root_node)->right_branch_);
-    set_balance(*root_node);
+    // change heights and quantity of elements after rotate
+    update((*root_node)->left_branch_);
+    update((*root_node)->right_branch_);
+    update(*root_node);
 }
 
-template<typename T>
-void AVL_tree<T>::RL_rotate(Node<T> ** root_node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::RL_rotate(Node<T, Aggregate> ** root_node)
 {
+    AVL_STATS(++stats_.rl_rotations_;)
+
     // combination of small R_rotate for B and L_rotate for A
     //        A                     C
     //      /   \                 /   \
@@ -626,8 +983,14 @@ void AVL_tree<T>::RL_rotate(Node<T> ** root_node)
     //      / \
     //    M    N
 
-    Node<T> * left_subtree_of_right_branch =  (*root_node)->right_branch_->left_branch_; // C
-    Node<T> * M = (*root_node)->right_branch_->left_branch_->left_branch_;
+    Node<T, Aggregate> * left_subtree_of_right_branch =  (*root_node)->right_branch_->left_branch_; // C
+    Node<T, Aggregate> * M = (*root_node)->right_branch_->left_branch_->left_branch_;
+
+    left_subtree_of_right_branch->parent_ = (*root_node)->parent_;
+    (*root_node)->right_branch_->parent_ = left_subtree_of_right_branch;
+    (*root_node)->parent_ = left_subtree_of_right_branch;
+    set_parent(M, *root_node);
+    set_parent(left_subtree_of_right_branch->right_branch_, (*root_node)->right_branch_);
 
     (*root_node)->right_branch_->left_branch_ = left_subtree_of_right_branch->right_branch_;
     left_subtree_of_right_branch->right_branch_ = (*root_node)->right_branch_;
@@ -635,234 +998,535 @@ void AVL_tree<T>::RL_rotate(Node<T> ** root_node)
     left_subtree_of_right_branch->left_branch_ = *root_node;
     *root_node = left_subtree_of_right_branch;
 
-
-    // change quantity of elements after rotate
-    (*root_node)->left_branch_->elements_ = elements_quantity((*root_node)->left_branch_->left_branch_) +
-                                            elements_quantity((*root_node)->left_branch_->right_branch_) + 1;
-    (*root_node)->right_branch_->elements_ = elements_quantity((*root_node)->right_branch_->left_branch_) +
-                                             elements_quantity((*root_node)->right_branch_->right_branch_) + 1;
-    (*root_node)->elements_ = elements_quantity((*root_node)->left_branch_) +
-                              elements_quantity((*root_node)->right_branch_) + 1;
-    // change balances after rotate
-    set_balance((*root_node)->left_branch_);
-    set_balance((*root_node)->right_branch_);
-    set_balance(*root_node);
+    // change heights and quantity of elements after rotate
+    update((*root_node)->left_branch_);
+    update((*root_node)->right_branch_);
+    update(*root_node);
 }
 
-template<typename T>
-void AVL_tree<T>::check_and_rotate(Node<T> ** node, T item)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::check_and_rotate(Node<T, Aggregate> ** node)
 {
-    if (abs(height((*node)->right_branch_) - height((*node)->left_branch_)) > 1)
-    {
-           if ((*node)->value_ < item && (*node)->right_branch_->value_ < item)
-               L_rotate(node);
-           else if ((*node)->value_ > item && (*node)->left_branch_->value_ > item)
-               R_rotate(node);
-           else if ((*node)->value_ > item && (*node)->left_branch_->value_ < item)
-               LR_rotate(node);
-           else if ((*node)->value_ < item && (*node)->right_branch_->value_ > item)
-               RL_rotate(node);
-    }
-}
+    // branches of the node are balanced, only the node itself can have a disbalance
+    int node_balance = balance(*node);
 
-template<typename T>
-void AVL_tree<T>::check_and_rotate(Node<T> ** node)
-{
-    if (abs(height((*node)->right_branch_) - height((*node)->left_branch_)) > 1)
+    if (node_balance > 1)
     {
-        if (height((*node)->right_branch_) > height((*node)->left_branch_))
-        {
-            // if there is a disbalance in a right_branch of node
-            if (height((*node)->right_branch_->right_branch_) < height((*node)->right_branch_->left_branch_) )
-                R_rotate(&(*node)->right_branch_);
+        // if there is a disbalance in a right_branch of node
+        if (balance((*node)->right_branch_) < 0)
+            RL_rotate(node);
+        else
             L_rotate(node);
-        }
+    }
+    else if (node_balance < -1)
+    {
+        // if there is a disbalance in a left_branch of node
+        if (balance((*node)->left_branch_) > 0)
+            LR_rotate(node);
         else
-        {
-            // if there is a disbalance in a left_branch of node
-            if (height((*node)->left_branch_->left_branch_) < height((*node)->left_branch_->right_branch_) )
-                L_rotate(&(*node)->left_branch_);
             R_rotate(node);
-        }
+    }
+    else
+    {
+        update(*node);
     }
 }
 
-template<typename T>
-void AVL_tree<T>::insert(Node<T> ** node, T item)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::rebalance_path(Node<T, Aggregate> ** path[], int count)
 {
-    if (*node == nullptr)
+    // links in the path stay valid after rotations below them
+    for (int i = count - 1; i >= 0; --i)
     {
-        *node = new Node<T>(item);
+        check_and_rotate(path[i]);
     }
-    else
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::join(Node<T, Aggregate> * left, Node<T, Aggregate> * middle, Node<T, Aggregate> * right)
+{
+    // links from the top of the higher tree to the place of middle
+    Node<T, Aggregate> ** path[max_height_];
+    int count = 0;
+    Node<T, Aggregate> * top = nullptr;
+    Node<T, Aggregate> ** link = &top;
+    Node<T, Aggregate> * parent = nullptr;
+
+    if (height(left) > height(right) + 1)
     {
-        if ((*node)->value_ < item)
+        // middle goes down the right side of the left tree to a branch as high as the right tree
+        top = left;
+
+        while (height(*link) > height(right) + 1)
         {
-            insert(&(*node)->right_branch_, item);
+            path[count++] = link;
+            parent = *link;
+            link = &(*link)->right_branch_;
         }
-        else if ((*node)->value_ > item)
+
+        middle->left_branch_ = *link;
+        middle->right_branch_ = right;
+    }
+    else if (height(right) > height(left) + 1)
+    {
+        // middle goes down the left side of the right tree to a branch as high as the left tree
+        top = right;
+
+        while (height(*link) > height(left) + 1)
         {
-            insert(&(*node)->left_branch_, item);
+            path[count++] = link;
+            parent = *link;
+            link = &(*link)->left_branch_;
         }
-        check_and_rotate(node, item);
-        set_balance(*node);
-        (*node)->elements_ = elements_quantity((*node)->left_branch_) +
-                             elements_quantity((*node)->right_branch_) + 1;;
+
+        middle->left_branch_ = left;
+        middle->right_branch_ = *link;
+    }
+    else
+    {
+        middle->left_branch_ = left;
+        middle->right_branch_ = right;
     }
+
+    set_parent(middle->left_branch_, middle);
+    set_parent(middle->right_branch_, middle);
+    middle->parent_ = parent;
+    update(middle);
+    *link = middle;
+
+    // heights on the path grow at most by 1, so usual rotations are enough
+    rebalance_path(path, count);
+    top->parent_ = nullptr;
+
+    return top;
 }
 
-template<typename T>
-void AVL_tree<T>::insert(T item)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::join(Node<T, Aggregate> * left, Node<T, Aggregate> * right)
 {
-    if (!is_there(item))
+    if (left == nullptr)
     {
-        insert(&root, item);
+        return right;
     }
-    else
+    if (right == nullptr)
     {
-        std::cerr << "\nValue " << item << " is already in the tree" << std::endl;
+        return left;
     }
+
+    Node<T, Aggregate> * middle = detach_min(&right);
+
+    return join(left, middle, right);
 }
 
-template<typename T>
-void AVL_tree<T>::remove(Node<T> ** node, T item)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::split_path(Node<T, Aggregate> * nodes[], const bool to_first[], int count, Node<T, Aggregate> * & first, Node<T, Aggregate> * & rest)
 {
-    // node for delete was found
-    if ((*node)->value_ == item)
+    first = nullptr;
+    rest = nullptr;
+
+    // from the bottom: a node with its other branch is joined to the part which was split below it
+    for (int i = count - 1; i >= 0; --i)
     {
-        // if it is a leaf
-        if ((*node)->left_branch_ == nullptr && (*node)->right_branch_ == nullptr)
+        Node<T, Aggregate> * node = nodes[i];
+
+        if (to_first[i])
         {
-            delete *node;
-            *node = nullptr;
+            Node<T, Aggregate> * l_branch = node->left_branch_;
+            set_parent(l_branch, nullptr);
+            first = join(l_branch, node, first);
         }
-        // if node has only right_branch
-        else if ((*node)->left_branch_ == nullptr)
+        else
         {
-            //          for_delete
-            //          /        \            ------->          r_branch
-            //        NULL     r_branch
-
-            Node<T> * r_branch = (*node)->right_branch_;
-            delete *node;
-            *node = r_branch;
+            Node<T, Aggregate> * r_branch = node->right_branch_;
+            set_parent(r_branch, nullptr);
+            rest = join(rest, node, r_branch);
         }
-         // if node has only left_branch
-        else if ((*node)->right_branch_ == nullptr)
-        {
-            //          for_delete
-            //          /        \            ------->          l_branch
-            //     l_branch      NULL
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::split(Node<T, Aggregate> * node, const T & item, Node<T, Aggregate> * & less, Node<T, Aggregate> * & not_less)
+{
+    Node<T, Aggregate> * nodes[max_height_];
+    bool to_less[max_height_];
+    int count = 0;
+
+    while (node != nullptr)
+    {
+        nodes[count] = node;
+        to_less[count] = comp_(node->value_, item);
+        node = to_less[count] ? node->right_branch_ : node->left_branch_;
+        ++count;
+    }
+
+    split_path(nodes, to_less, count, less, not_less);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::split_rank(Node<T, Aggregate> * node, int k, Node<T, Aggregate> * & first, Node<T, Aggregate> * & rest)
+{
+    Node<T, Aggregate> * nodes[max_height_];
+    bool to_first[max_height_];
+    int count = 0;
+
+    while (node != nullptr)
+    {
+        nodes[count] = node;
+        to_first[count] = elements_quantity(node->left_branch_) < k;
 
-            Node<T> * l_branch = (*node)->left_branch_;
-            delete *node;
-            *node = l_branch;
+        if (to_first[count])
+        {
+            k -= elements_quantity(node->left_branch_) + 1;
+            node = node->right_branch_;
         }
-        else // there are 2 branches
+        else
         {
-            Node<T> * r_branch = (*node)->right_branch_;
-            Node<T> * l_branch = (*node)->left_branch_;
-            delete *node;
+            node = node->left_branch_;
+        }
+        ++count;
+    }
 
-            // find min elem in the right subtree
-            Node<T> * the_smallest_elem_in_right_branch = r_branch;
-            Node<T> * parent_of_the_smallest_elem_in_right_branch = r_branch;
+    split_path(nodes, to_first, count, first, rest);
+}
 
-            while(the_smallest_elem_in_right_branch->left_branch_ != nullptr)
-            {
-                parent_of_the_smallest_elem_in_right_branch = the_smallest_elem_in_right_branch;
-                the_smallest_elem_in_right_branch = the_smallest_elem_in_right_branch->left_branch_;
-                parent_of_the_smallest_elem_in_right_branch->elements_ -= 1;
-            }
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::detach_min(Node<T, Aggregate> ** node)
+{
+    Node<T, Aggregate> ** path[max_height_];
+    int count = 0;
+    Node<T, Aggregate> ** link = node;
 
-            the_smallest_elem_in_right_branch->left_branch_ = l_branch;
+    while ((*link)->left_branch_ != nullptr)
+    {
+        path[count++] = link;
+        link = &(*link)->left_branch_;
+    }
 
-            if (the_smallest_elem_in_right_branch != parent_of_the_smallest_elem_in_right_branch)
-            {
-                //            for_delete                                       smallest
-                //          /           \                    ------>         /         \
-                //  l_branch            r_branch                       l_branch         r_branch
-                //                     /       /_\                                     /        /_\
-                //     parent_of_the_smallest                           parent_of_the_smallest
-                //          /          /_\                                   /         /_\
-                //    smallest                                  smallest_r_branch
-                //     /    \
-                //  NULL   smallest_r_branch
-
-                Node<T> * smallest_r_branch = the_smallest_elem_in_right_branch->right_branch_;
-                the_smallest_elem_in_right_branch->right_branch_ = r_branch;
-                parent_of_the_smallest_elem_in_right_branch->left_branch_ = smallest_r_branch;
-            }
+    Node<T, Aggregate> * min_node = *link;
+    *link = min_node->right_branch_;
+    set_parent(*link, min_node->parent_);
+    rebalance_path(path, count);
 
-            *node = the_smallest_elem_in_right_branch;
+    min_node->right_branch_ = nullptr;
+    min_node->parent_ = nullptr;
+    update(min_node);
 
-            check_and_rotate(&parent_of_the_smallest_elem_in_right_branch);
-            check_and_rotate(&r_branch);
+    return min_node;
+}
 
-            (*node)->elements_ = elements_quantity((*node)->left_branch_) +
-                                 elements_quantity((*node)->right_branch_) + 1;
-            set_balance(*node);
-        }
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::detach_max(Node<T, Aggregate> ** node)
+{
+    Node<T, Aggregate> ** path[max_height_];
+    int count = 0;
+    Node<T, Aggregate> ** link = node;
+
+    while ((*link)->right_branch_ != nullptr)
+    {
+        path[count++] = link;
+        link = &(*link)->right_branch_;
     }
-    // finding node for delete
-    else
+
+    Node<T, Aggregate> * max_node = *link;
+    *link = max_node->left_branch_;
+    set_parent(*link, max_node->parent_);
+    rebalance_path(path, count);
+
+    max_node->left_branch_ = nullptr;
+    max_node->parent_ = nullptr;
+    update(max_node);
+
+    return max_node;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> ** AVL_tree<T, Compare, Allocator, Aggregate>::find_link(const T & item, Node<T, Aggregate> ** path[], int & count, Node<T, Aggregate> * & parent)
+{
+    Node<T, Aggregate> ** link = &root;
+    AVL_STATS(++stats_.descents_;)
+
+    while (*link != nullptr)
     {
-        if ((*node)->value_ < item)
+        AVL_STATS(++stats_.visited_nodes_;)
+
+        if (comp_((*link)->value_, item))
         {
-            remove(&(*node)->right_branch_, item);
+            path[count++] = link;
+            parent = *link;
+            link = &(*link)->right_branch_;
         }
-        else if ((*node)->value_ > item)
+        else if (comp_(item, (*link)->value_))
         {
-            remove(&(*node)->left_branch_, item);
+            path[count++] = link;
+            parent = *link;
+            link = &(*link)->left_branch_;
         }
+        else
+        {
+            // the item is already in the tree
+            break;
+        }
+    }
+
+    return link;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::attach(Node<T, Aggregate> * item_node, Node<T, Aggregate> ** link, Node<T, Aggregate> * parent, Node<T, Aggregate> ** path[], int count)
+{
+    item_node->parent_ = parent;
+    *link = item_node;
 
-        check_and_rotate(node, item);
-        set_balance(*node);
-        (*node)->elements_ = elements_quantity((*node)->left_branch_) +
-                             elements_quantity((*node)->right_branch_) + 1;
+    rebalance_path(path, count);
+
+    return item_node;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::count_duplicate(const T & item)
+{
+    ++duplicates_;
+
+    if constexpr (requires { std::cerr << item; })
+    {
+        if (!quiet_)
+        {
+            std::cerr << "\nValue " << item << " is already in the tree" << std::endl;
+        }
     }
 }
 
-template<typename T>
-void AVL_tree<T>::remove(T item)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+std::pair<typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T>, bool> AVL_tree<T, Compare, Allocator, Aggregate>::insert(const T & item)
 {
+    // links from the root to the place of the item
+    Node<T, Aggregate> ** path[max_height_];
+    int count = 0;
+    Node<T, Aggregate> * parent = nullptr;
+    Node<T, Aggregate> ** link = find_link(item, path, count, parent);
 
-    if (is_there(item))
+    if (*link != nullptr)
     {
-        remove(&root, item);
+        count_duplicate(item);
+
+        return std::pair<iterator<T>, bool>(make_iterator(*link), false);
     }
-    else
+
+    return std::pair<iterator<T>, bool>(make_iterator(attach(create_node(item), link, parent, path, count)), true);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+std::pair<typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T>, bool> AVL_tree<T, Compare, Allocator, Aggregate>::insert(T && item)
+{
+    Node<T, Aggregate> ** path[max_height_];
+    int count = 0;
+    Node<T, Aggregate> * parent = nullptr;
+    Node<T, Aggregate> ** link = find_link(item, path, count, parent);
+
+    if (*link != nullptr)
     {
-        std::cerr << "\nThere isn`t " << item << " in the tree." << std::endl;
+        count_duplicate(item);
+
+        return std::pair<iterator<T>, bool>(make_iterator(*link), false);
     }
+
+    // the item is moved only when it is really inserted
+    return std::pair<iterator<T>, bool>(make_iterator(attach(create_node(std::move(item)), link, parent, path, count)), true);
 }
 
-template<typename T>
-int AVL_tree<T>::size() const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename... Args>
+std::pair<typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T>, bool> AVL_tree<T, Compare, Allocator, Aggregate>::emplace(Args &&... args)
 {
-    return this->root->elements_;
+    // the key is known only after the value is made
+    Node<T, Aggregate> * item_node = create_node(std::forward<Args>(args)...);
+    Node<T, Aggregate> ** path[max_height_];
+    int count = 0;
+    Node<T, Aggregate> * parent = nullptr;
+    Node<T, Aggregate> ** link = find_link(item_node->value_, path, count, parent);
+
+    if (*link != nullptr)
+    {
+        count_duplicate(item_node->value_);
+        destroy_node(item_node);
+
+        return std::pair<iterator<T>, bool>(make_iterator(*link), false);
+    }
+
+    return std::pair<iterator<T>, bool>(make_iterator(attach(item_node, link, parent, path, count)), true);
 }
 
-template<typename T>
-void AVL_tree<T>::show(Node<T> * node) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::remove(Node<T, Aggregate> ** node, const T & item)
 {
-    if (node != nullptr)
+    // links from the top of the branch to the changed nodes
+    Node<T, Aggregate> ** path[max_height_];
+    int count = 0;
+    Node<T, Aggregate> ** link = node;
+
+    AVL_STATS(++stats_.descents_;)
+
+    // finding node for delete
+    while (*link != nullptr && (comp_((*link)->value_, item) || comp_(item, (*link)->value_)))
+    {
+        AVL_STATS(++stats_.visited_nodes_;)
+        path[count++] = link;
+
+        if (comp_((*link)->value_, item))
+        {
+            link = &(*link)->right_branch_;
+        }
+        else
+        {
+            link = &(*link)->left_branch_;
+        }
+    }
+
+    if (*link == nullptr)
+    {
+        return false;
+    }
+
+    // node for delete was found
+    Node<T, Aggregate> * for_delete = *link;
+
+    // if node has only right_branch or it is a leaf
+    if (for_delete->left_branch_ == nullptr)
+    {
+        //          for_delete
+        //          /        \            ------->          r_branch
+        //        NULL     r_branch
+
+        *link = for_delete->right_branch_;
+        set_parent(*link, for_delete->parent_);
+    }
+    // if node has only left_branch
+    else if (for_delete->right_branch_ == nullptr)
+    {
+        //          for_delete
+        //          /        \            ------->          l_branch
+        //     l_branch      NULL
+
+        *link = for_delete->left_branch_;
+        set_parent(*link, for_delete->parent_);
+    }
+    else // there are 2 branches
+    {
+        //            for_delete                                       smallest
+        //          /           \                    ------>         /         \
+        //  l_branch            r_branch                       l_branch         r_branch
+        //                     /       /_\                                     /        /_\
+        //                   ...                                             ...
+        //                  /                                               /
+        //            smallest                                     smallest_r_branch
+        //             /    \
+        //          NULL   smallest_r_branch
+
+        int for_delete_index = count;
+        path[count++] = link;
+
+        Node<T, Aggregate> ** smallest_link = &for_delete->right_branch_;
+
+        while ((*smallest_link)->left_branch_ != nullptr)
+        {
+            path[count++] = smallest_link;
+            smallest_link = &(*smallest_link)->left_branch_;
+        }
+
+        Node<T, Aggregate> * the_smallest_elem_in_right_branch = *smallest_link;
+        *smallest_link = the_smallest_elem_in_right_branch->right_branch_;
+        set_parent(*smallest_link, the_smallest_elem_in_right_branch->parent_);
+
+        the_smallest_elem_in_right_branch->left_branch_ = for_delete->left_branch_;
+        the_smallest_elem_in_right_branch->right_branch_ = for_delete->right_branch_;
+        the_smallest_elem_in_right_branch->parent_ = for_delete->parent_;
+        set_parent(the_smallest_elem_in_right_branch->left_branch_, the_smallest_elem_in_right_branch);
+        set_parent(the_smallest_elem_in_right_branch->right_branch_, the_smallest_elem_in_right_branch);
+        *link = the_smallest_elem_in_right_branch;
+
+        // the link below for_delete was inside of it
+        if (count > for_delete_index + 1)
+        {
+            path[for_delete_index + 1] = &the_smallest_elem_in_right_branch->right_branch_;
+        }
+    }
+
+    destroy_node(for_delete);
+    rebalance_path(path, count);
+
+    return true;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::remove(const T & item)
+{
+    if (!remove(&root, item))
     {
-        show(node->left_branch_);
-        std::cout << node->value_ << ' ';
-        show(node->right_branch_);
+        if constexpr (requires { std::cerr << item; })
+        {
+            std::cerr << "\nThere isn`t " << item << " in the tree." << std::endl;
+        }
     }
 }
 
-template<typename T>
-void AVL_tree<T>::show() const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::size() const
+{
+    return elements_quantity(root);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::set_quiet(bool quiet)
+{
+    quiet_ = quiet;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+std::size_t AVL_tree<T, Compare, Allocator, Aggregate>::duplicates() const
+{
+    return duplicates_;
+}
+
+#ifdef AVL_TREE_STATS
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Tree_stats AVL_tree<T, Compare, Allocator, Aggregate>::stats() const
+{
+    Tree_stats stats = stats_;
+    stats.duplicates_ = duplicates_;
+    stats.size_ = size();
+    stats.height_ = height(root);
+
+    return stats;
+}
+#endif
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Allocator AVL_tree<T, Compare, Allocator, Aggregate>::get_allocator() const
+{
+    return Allocator(allocator_);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Compare AVL_tree<T, Compare, Allocator, Aggregate>::key_comp() const
+{
+    return comp_;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::show(Node<T, Aggregate> * node) const
+{
+    std::cout << const_cast<const Node<T, Aggregate> *>(node);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::show() const
 {
     show(root);
     std::cout << '\n';
 }
 
-template<typename T>
-void AVL_tree<T>::print_n(const Node<T> * node, int n, int level, int prob) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::print_n(const Node<T, Aggregate> * node, int n, int level, int prob) const
 {
     if (node != nullptr)
     {
@@ -880,8 +1544,8 @@ void AVL_tree<T>::print_n(const Node<T> * node, int n, int level, int prob) cons
     }
 }
 
-template<typename T>
-void AVL_tree<T>::print(const Node<T> * node) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::print(const Node<T, Aggregate> * node) const
 {
     int h = height(node);
     int prob = 4;
@@ -895,36 +1559,42 @@ void AVL_tree<T>::print(const Node<T> * node) const
     }
 }
 
-template<typename T>
-void AVL_tree<T>::print() const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::print() const
 {
     print(root);
 }
 
-template<typename T>
-T AVL_tree<T>::min(Node<T> * node) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+const T & AVL_tree<T, Compare, Allocator, Aggregate>::min(Node<T, Aggregate> * node) const
 {
-    Node<T> * current_node = node;
+    Node<T, Aggregate> * current_node = node;
 
     while(current_node->left_branch_ != nullptr)
+    {
+        AVL_STATS(++stats_.visited_nodes_;)
         current_node = current_node->left_branch_;
+    }
 
     return current_node->value_;
 }
 
-template<typename T>
-T AVL_tree<T>::max(Node<T> * node) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+const T & AVL_tree<T, Compare, Allocator, Aggregate>::max(Node<T, Aggregate> * node) const
 {
-    Node<T> * current_node = node;
+    Node<T, Aggregate> * current_node = node;
 
     while(current_node->right_branch_ != nullptr)
+    {
+        AVL_STATS(++stats_.visited_nodes_;)
         current_node = current_node->right_branch_;
+    }
 
     return current_node->value_;
 }
 
-template<typename T>
-int AVL_tree<T>::elements_quantity(Node<T> * node) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::elements_quantity(Node<T, Aggregate> * node) const
 {
     if (node == nullptr)
     {
@@ -936,114 +1606,833 @@ int AVL_tree<T>::elements_quantity(Node<T> * node) const
     }
 }
 
-template<typename T>
-T AVL_tree<T>::k_th_order_statistic(int i) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::is_valid() const
 {
-    if (i <= 0 || i > elements_quantity(root))
+    return is_valid(root, nullptr, nullptr, nullptr);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::is_valid(const Node<T, Aggregate> * node, const Node<T, Aggregate> * parent,
+                                                          const T * low, const T * high) const
+{
+    if (node == nullptr)
     {
-        std::cerr << "Uncorrect element number." << std::endl;
+        return true;
     }
-    else
+
+    const Node<T, Aggregate> * left = node->left_branch_;
+    const Node<T, Aggregate> * right = node->right_branch_;
+    int left_height = height(left);
+    int right_height = height(right);
+
+    // the value of the node bounds values of its branches
+    return node->parent_ == parent &&
+           node->count_ > 0 &&
+           node->height_ == std::max(left_height, right_height) + 1 &&
+           std::abs(right_height - left_height) <= 1 &&
+           node->elements_ == node->count_ + (left != nullptr ? left->elements_ : 0) + (right != nullptr ? right->elements_ : 0) &&
+           (low == nullptr || comp_(*low, node->value_)) &&
+           (high == nullptr || comp_(node->value_, *high)) &&
+           is_valid(left, node, low, &node->value_) &&
+           is_valid(right, node, &node->value_, high);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename Aggregate::value_type AVL_tree<T, Compare, Allocator, Aggregate>::aggregate_of(const Node<T, Aggregate> * node)
+{
+    return node == nullptr ? Aggregate::identity() : node->aggregate_;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename Aggregate::value_type AVL_tree<T, Compare, Allocator, Aggregate>::aggregate() const
+{
+    return aggregate_of(root);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename Aggregate::value_type AVL_tree<T, Compare, Allocator, Aggregate>::prefix_aggregate(const T & item) const
+{
+    Node<T, Aggregate> * current_node = root;
+    typename Aggregate::value_type result = Aggregate::identity();
+    AVL_STATS(++stats_.descents_;)
+
+    while(current_node != nullptr)
     {
-        Node<T> * current_node = root;
+        AVL_STATS(++stats_.visited_nodes_;)
 
-        while(true)
+        if (comp_(current_node->value_, item))
         {
-            if (elements_quantity(current_node) == i)
-            {
-                return max(current_node);
-            }
-            else if (i == 1)
-            {
-                return min(current_node);
-            }
-            else if (elements_quantity(current_node->left_branch_) == i)
-            {
-                return max(current_node->left_branch_);
-            }
-            else if (elements_quantity(current_node->left_branch_) + 1 == i)
-            {
-                return current_node->value_;
-            }
-            else if (elements_quantity(current_node->left_branch_) < i)
-            {
-                i -= (elements_quantity(current_node->left_branch_) + 1);
-                current_node = current_node->right_branch_;
-            }
-            else if (elements_quantity(current_node->left_branch_) > i)
-            {
-                current_node = current_node->left_branch_;
-            }
+            // the node and its left branch are less than item
+            result = Aggregate::combine(result, Aggregate::combine(aggregate_of(current_node->left_branch_),
+                                                                   Aggregate::of(current_node->value_, current_node->count_)));
+            current_node = current_node->right_branch_;
+        }
+        else
+        {
+            current_node = current_node->left_branch_;
         }
     }
+
+    return result;
 }
 
-template<typename T>
-int AVL_tree<T>::elem_less_than(T item) const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename Aggregate::value_type AVL_tree<T, Compare, Allocator, Aggregate>::range_aggregate(const T & first, const T & last) const
 {
-    Node<T> * current_node = root;
-    Node<T> * parent = root;
-    int count = 0;
+    // the highest node in the range, the paths to both ends of the range go from it
+    Node<T, Aggregate> * top = root;
+    AVL_STATS(++stats_.descents_;)
+
+    while (top != nullptr && (comp_(top->value_, first) || !comp_(top->value_, last)))
+    {
+        AVL_STATS(++stats_.visited_nodes_;)
+        top = comp_(top->value_, first) ? top->right_branch_ : top->left_branch_;
+    }
+
+    if (top == nullptr || !comp_(first, last))
+    {
+        return Aggregate::identity();
+    }
+
+    // elements of the left branch which are not less than first, they are taken from right to left
+    typename Aggregate::value_type left = Aggregate::identity();
+    Node<T, Aggregate> * node = top->left_branch_;
 
-    while(current_node != nullptr && current_node->right_branch_ != nullptr)
+    while (node != nullptr)
     {
-        if (current_node->value_ >= item)
+        AVL_STATS(++stats_.visited_nodes_;)
+
+        if (!comp_(node->value_, first))
         {
-            parent = current_node;
-            current_node = current_node->left_branch_;
+            left = Aggregate::combine(Aggregate::combine(Aggregate::of(node->value_, node->count_), aggregate_of(node->right_branch_)), left);
+            node = node->left_branch_;
         }
         else
         {
-            count += current_node->elements_ - current_node->right_branch_->elements_;
-            parent = current_node;
-            current_node = current_node->right_branch_;
+            node = node->right_branch_;
         }
     }
 
-    if (current_node->value_ < item)
+    // elements of the right branch which are less than last, they are taken from left to right
+    typename Aggregate::value_type right = Aggregate::identity();
+    node = top->right_branch_;
+
+    while (node != nullptr)
     {
-        count += current_node->elements_;
+        AVL_STATS(++stats_.visited_nodes_;)
+
+        if (comp_(node->value_, last))
+        {
+            right = Aggregate::combine(right, Aggregate::combine(aggregate_of(node->left_branch_), Aggregate::of(node->value_, node->count_)));
+            node = node->right_branch_;
+        }
+        else
+        {
+            node = node->left_branch_;
+        }
     }
 
-    return count;
+    return Aggregate::combine(Aggregate::combine(left, Aggregate::of(top->value_, top->count_)), right);
 }
 
-template<typename T>
-T AVL_tree<T>::min() const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename Aggregate::value_type AVL_tree<T, Compare, Allocator, Aggregate>::rank_aggregate(int first, int last) const
 {
-    Node<T> * current_node = root;
+    if (first <= 0 || last > elements_quantity(root) || first > last)
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return Aggregate::identity();
+    }
 
-    while(current_node->left_branch_ != nullptr)
-        current_node = current_node->left_branch_;
+    // the same walk as in range_aggregate, but by ranks, rank of a node is skipped + its left branch + 1
+    Node<T, Aggregate> * top = root;
+    int skipped = 0;
+
+    while (true)
+    {
+        int rank = skipped + elements_quantity(top->left_branch_) + 1;
+
+        if (rank < first)
+        {
+            skipped = rank;
+            top = top->right_branch_;
+        }
+        else if (rank > last)
+        {
+            top = top->left_branch_;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    int top_rank = skipped + elements_quantity(top->left_branch_) + 1;
+    typename Aggregate::value_type left = Aggregate::identity();
+    Node<T, Aggregate> * node = top->left_branch_;
+
+    while (node != nullptr)
+    {
+        int rank = skipped + elements_quantity(node->left_branch_) + 1;
+
+        if (rank >= first)
+        {
+            left = Aggregate::combine(Aggregate::combine(Aggregate::of(node->value_, 1), aggregate_of(node->right_branch_)), left);
+            node = node->left_branch_;
+        }
+        else
+        {
+            skipped = rank;
+            node = node->right_branch_;
+        }
+    }
+
+    typename Aggregate::value_type right = Aggregate::identity();
+    skipped = top_rank;
+    node = top->right_branch_;
+
+    while (node != nullptr)
+    {
+        int rank = skipped + elements_quantity(node->left_branch_) + 1;
+
+        if (rank <= last)
+        {
+            right = Aggregate::combine(right, Aggregate::combine(aggregate_of(node->left_branch_), Aggregate::of(node->value_, 1)));
+            skipped = rank;
+            node = node->right_branch_;
+        }
+        else
+        {
+            node = node->left_branch_;
+        }
+    }
+
+    return Aggregate::combine(Aggregate::combine(left, Aggregate::of(top->value_, 1)), right);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+T AVL_tree<T, Compare, Allocator, Aggregate>::k_th_order_statistic(int i) const
+{
+    if (i <= 0 || i > elements_quantity(root))
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return T();
+    }
+    else
+    {
+        Node<T, Aggregate> * current_node = root;
+        AVL_STATS(++stats_.descents_;)
+
+        while(true)
+        {
+            AVL_STATS(++stats_.visited_nodes_;)
+
+            if (elements_quantity(current_node) == i)
+            {
+                return max(current_node);
+            }
+            else if (i == 1)
+            {
+                return min(current_node);
+            }
+            else if (elements_quantity(current_node->left_branch_) == i)
+            {
+                return max(current_node->left_branch_);
+            }
+            else if (elements_quantity(current_node->left_branch_) + 1 == i)
+            {
+                return current_node->value_;
+            }
+            else if (elements_quantity(current_node->left_branch_) < i)
+            {
+                i -= (elements_quantity(current_node->left_branch_) + 1);
+                current_node = current_node->right_branch_;
+            }
+            else if (elements_quantity(current_node->left_branch_) > i)
+            {
+                current_node = current_node->left_branch_;
+            }
+        }
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K>
+int AVL_tree<T, Compare, Allocator, Aggregate>::count_less(const K & item) const
+{
+    Node<T, Aggregate> * current_node = root;
+    int count = 0;
+    AVL_STATS(++stats_.descents_;)
+
+    while(current_node != nullptr)
+    {
+        AVL_STATS(++stats_.visited_nodes_;)
+
+        if (comp_(current_node->value_, item))
+        {
+            // the node and its left branch are less than item
+            count += elements_quantity(current_node->left_branch_) + current_node->count_;
+            current_node = current_node->right_branch_;
+        }
+        else
+        {
+            current_node = current_node->left_branch_;
+        }
+    }
+
+    return count;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::elem_less_than(const T & item) const
+{
+    return count_less(item);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K, typename C, typename>
+int AVL_tree<T, Compare, Allocator, Aggregate>::elem_less_than(const K & item) const
+{
+    return count_less(item);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::lower_bound_node(const K & item) const
+{
+    Node<T, Aggregate> * current_node = root;
+    Node<T, Aggregate> * bound = nullptr;
+
+    while(current_node != nullptr)
+    {
+        if (comp_(current_node->value_, item))
+        {
+            current_node = current_node->right_branch_;
+        }
+        else
+        {
+            // the node is a candidate, smaller ones can be only in its left branch
+            bound = current_node;
+            current_node = current_node->left_branch_;
+        }
+    }
+
+    return bound;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::upper_bound_node(const K & item) const
+{
+    Node<T, Aggregate> * current_node = root;
+    Node<T, Aggregate> * bound = nullptr;
+
+    while(current_node != nullptr)
+    {
+        if (comp_(item, current_node->value_))
+        {
+            bound = current_node;
+            current_node = current_node->left_branch_;
+        }
+        else
+        {
+            current_node = current_node->right_branch_;
+        }
+    }
+
+    return bound;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T> AVL_tree<T, Compare, Allocator, Aggregate>::lower_bound(const T & item) const
+{
+    Node<T, Aggregate> * bound = lower_bound_node(item);
+
+    return bound == nullptr ? end() : make_iterator(bound);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T> AVL_tree<T, Compare, Allocator, Aggregate>::upper_bound(const T & item) const
+{
+    Node<T, Aggregate> * bound = upper_bound_node(item);
+
+    return bound == nullptr ? end() : make_iterator(bound);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+std::pair<typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T>, typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T>>
+AVL_tree<T, Compare, Allocator, Aggregate>::equal_range(const T & item) const
+{
+    return std::pair<iterator<T>, iterator<T>>(lower_bound(item), upper_bound(item));
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::count_in_range(const T & first, const T & last) const
+{
+    if (!comp_(first, last))
+    {
+        return 0;
+    }
+
+    return count_less(last) - count_less(first);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K, typename C, typename>
+typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T> AVL_tree<T, Compare, Allocator, Aggregate>::lower_bound(const K & item) const
+{
+    Node<T, Aggregate> * bound = lower_bound_node(item);
+
+    return bound == nullptr ? end() : make_iterator(bound);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K, typename C, typename>
+typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T> AVL_tree<T, Compare, Allocator, Aggregate>::upper_bound(const K & item) const
+{
+    Node<T, Aggregate> * bound = upper_bound_node(item);
+
+    return bound == nullptr ? end() : make_iterator(bound);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K, typename C, typename>
+std::pair<typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T>, typename AVL_tree<T, Compare, Allocator, Aggregate>::template iterator<T>>
+AVL_tree<T, Compare, Allocator, Aggregate>::equal_range(const K & item) const
+{
+    return std::pair<iterator<T>, iterator<T>>(lower_bound(item), upper_bound(item));
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+template<typename K, typename C, typename>
+int AVL_tree<T, Compare, Allocator, Aggregate>::count_in_range(const K & first, const K & last) const
+{
+    if (!comp_(first, last))
+    {
+        return 0;
+    }
+
+    return count_less(last) - count_less(first);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::k_th_batch(std::span<const int> ranks, std::span<T> results) const
+{
+    if (results.size() < ranks.size())
+    {
+        std::cerr << "There is no place for all results." << std::endl;
+        return;
+    }
+
+    // numbers of queries sorted by rank
+    std::vector<int> order(ranks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&ranks](int left, int right) { return ranks[left] < ranks[right]; });
+
+    // skip uncorrect ranks at the both ends
+    int first = 0;
+    int last = static_cast<int>(order.size());
+
+    while (first < last && ranks[order[first]] <= 0)
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        results[order[first++]] = T();
+    }
+    while (first < last && ranks[order[last - 1]] > elements_quantity(root))
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        results[order[--last]] = T();
+    }
+
+    // every part of queries goes down to the branch which contains their elements
+    struct Part
+    {
+        Node<T, Aggregate> * node_;
+        int first_;
+        int last_;
+        int skipped_; // quantity of elements before the branch
+    };
+    Part stack[2 * max_height_];
+    int count = 0;
+
+    if (first < last)
+    {
+        stack[count++] = Part{root, first, last, 0};
+    }
+
+    while (count > 0)
+    {
+        Part part = stack[--count];
+        int node_rank = part.skipped_ + elements_quantity(part.node_->left_branch_) + 1;
+
+        // queries before the node go to the left branch, queries after it go to the right one
+        int left_last = std::partition_point(order.begin() + part.first_, order.begin() + part.last_,
+                                             [&ranks, node_rank](int j) { return ranks[j] < node_rank; }) - order.begin();
+
+        int right_first = left_last;
+        while (right_first < part.last_ && ranks[order[right_first]] == node_rank)
+            results[order[right_first++]] = part.node_->value_;
+
+        if (right_first < part.last_)
+        {
+            __builtin_prefetch(part.node_->right_branch_);
+            stack[count++] = Part{part.node_->right_branch_, right_first, part.last_, node_rank};
+        }
+        if (part.first_ < left_last)
+        {
+            __builtin_prefetch(part.node_->left_branch_);
+            stack[count++] = Part{part.node_->left_branch_, part.first_, left_last, part.skipped_};
+        }
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::elem_less_than_batch(std::span<const T> items, std::span<int> results) const
+{
+    if (results.size() < items.size())
+    {
+        std::cerr << "There is no place for all results." << std::endl;
+        return;
+    }
+
+    // numbers of queries sorted by item
+    std::vector<int> order(items.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this, &items](int left, int right) { return comp_(items[left], items[right]); });
+
+    // every part of queries goes down to the branch where their items would be
+    struct Part
+    {
+        Node<T, Aggregate> * node_;
+        int first_;
+        int last_;
+        int less_; // quantity of elements before the branch
+    };
+    Part stack[2 * max_height_];
+    int count = 0;
+
+    stack[count++] = Part{root, 0, static_cast<int>(order.size()), 0};
+
+    while (count > 0)
+    {
+        Part part = stack[--count];
+
+        if (part.node_ == nullptr)
+        {
+            for (int j = part.first_; j < part.last_; ++j)
+                results[order[j]] = part.less_;
+
+            continue;
+        }
+
+        // items which are not bigger than the node go to the left branch
+        Node<T, Aggregate> * node = part.node_;
+        int middle = std::partition_point(order.begin() + part.first_, order.begin() + part.last_,
+                                          [this, &items, node](int j) { return !comp_(node->value_, items[j]); }) - order.begin();
+
+        if (middle < part.last_)
+        {
+            __builtin_prefetch(part.node_->right_branch_);
+            stack[count++] = Part{part.node_->right_branch_, middle, part.last_,
+                                  part.less_ + elements_quantity(part.node_->left_branch_) + part.node_->count_};
+        }
+        if (part.first_ < middle)
+        {
+            __builtin_prefetch(part.node_->left_branch_);
+            stack[count++] = Part{part.node_->left_branch_, part.first_, middle, part.less_};
+        }
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::erase_range(const T & first, const T & last)
+{
+    if (!comp_(first, last))
+    {
+        return 0;
+    }
+
+    Node<T, Aggregate> * less = nullptr;
+    Node<T, Aggregate> * rest = nullptr;
+    Node<T, Aggregate> * middle = nullptr;
+    Node<T, Aggregate> * greater = nullptr;
+
+    split(root, first, less, rest);
+    split(rest, last, middle, greater);
+
+    int count = elements_quantity(middle);
+    delete_all(middle);
+    root = join(less, greater);
+
+    return count;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+int AVL_tree<T, Compare, Allocator, Aggregate>::erase_rank_range(int first, int last)
+{
+    if (first <= 0 || last > elements_quantity(root) || first > last)
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return 0;
+    }
+
+    Node<T, Aggregate> * less = nullptr;
+    Node<T, Aggregate> * rest = nullptr;
+    Node<T, Aggregate> * middle = nullptr;
+    Node<T, Aggregate> * greater = nullptr;
+
+    split_rank(root, first - 1, less, rest);
+    split_rank(rest, last - first + 1, middle, greater);
+
+    int count = elements_quantity(middle);
+    delete_all(middle);
+    root = join(less, greater);
+
+    return count;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+T AVL_tree<T, Compare, Allocator, Aggregate>::pop_min()
+{
+    if (root == nullptr)
+    {
+        std::cerr << "The tree is empty." << std::endl;
+        return T();
+    }
+
+    Node<T, Aggregate> * min_node = detach_min(&root);
+    T value = min_node->value_;
+    destroy_node(min_node);
+
+    return value;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+T AVL_tree<T, Compare, Allocator, Aggregate>::pop_max()
+{
+    if (root == nullptr)
+    {
+        std::cerr << "The tree is empty." << std::endl;
+        return T();
+    }
+
+    Node<T, Aggregate> * max_node = detach_max(&root);
+    T value = max_node->value_;
+    destroy_node(max_node);
+
+    return value;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Node<T, Aggregate> * AVL_tree<T, Compare, Allocator, Aggregate>::unite(Node<T, Aggregate> * left, Node<T, Aggregate> * right)
+{
+    if (left == nullptr)
+    {
+        return right;
+    }
+    if (right == nullptr)
+    {
+        return left;
+    }
+
+    // right is split by the root of left, the parts are united with branches of left,
+    // depth of the recursion is the height of left
+    Node<T, Aggregate> * l_branch = left->left_branch_;
+    Node<T, Aggregate> * r_branch = left->right_branch_;
+    Node<T, Aggregate> * less = nullptr;
+    Node<T, Aggregate> * not_less = nullptr;
+
+    set_parent(l_branch, nullptr);
+    set_parent(r_branch, nullptr);
+    split(right, left->value_, less, not_less);
+
+    if (not_less != nullptr && !comp_(left->value_, min(not_less)))
+    {
+        // the same value is in both trees
+        destroy_node(detach_min(&not_less));
+    }
+
+    l_branch = unite(l_branch, less);
+    r_branch = unite(r_branch, not_less);
+
+    return join(l_branch, left, r_branch);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+std::pair<AVL_tree<T, Compare, Allocator, Aggregate>, AVL_tree<T, Compare, Allocator, Aggregate>> AVL_tree<T, Compare, Allocator, Aggregate>::split(const T & item)
+{
+    std::pair<AVL_tree<T, Compare, Allocator, Aggregate>, AVL_tree<T, Compare, Allocator, Aggregate>> parts;
+
+    // nodes stay in the same allocator
+    parts.first.allocator_ = allocator_;
+    parts.second.allocator_ = allocator_;
+    parts.first.comp_ = comp_;
+    parts.second.comp_ = comp_;
+    parts.first.quiet_ = quiet_;
+    parts.second.quiet_ = quiet_;
+
+    split(root, item, parts.first.root, parts.second.root);
+    root = nullptr;
+
+    return parts;
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::join(AVL_tree<T, Compare, Allocator, Aggregate> && tree)
+{
+    if (this == &tree || tree.root == nullptr)
+    {
+        return;
+    }
+
+    if (allocator_ == tree.allocator_ && (root == nullptr || comp_(max(root), min(tree.root))))
+    {
+        Node<T, Aggregate> * middle = detach_min(&tree.root);
+        root = join(root, middle, tree.root);
+        tree.root = nullptr;
+    }
+    else
+    {
+        merge(std::move(tree));
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+void AVL_tree<T, Compare, Allocator, Aggregate>::merge(AVL_tree<T, Compare, Allocator, Aggregate> && tree)
+{
+    if (this == &tree || tree.root == nullptr)
+    {
+        return;
+    }
+
+    Node<T, Aggregate> * other = tree.root;
+
+    if (allocator_ != tree.allocator_)
+    {
+        // nodes of the other allocator can not be taken, so they are copied
+        std::vector<T> values(tree.begin(), tree.end());
+        other = build(values.data(), static_cast<int>(values.size()));
+        tree.delete_all(tree.root);
+    }
+
+    tree.root = nullptr;
+
+    // the smaller tree is split by the bigger one
+    if (elements_quantity(root) >= elements_quantity(other))
+    {
+        root = unite(root, other);
+    }
+    else
+    {
+        root = unite(other, root);
+    }
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+T AVL_tree<T, Compare, Allocator, Aggregate>::min() const
+{
+    Node<T, Aggregate> * current_node = root;
+    AVL_STATS(++stats_.descents_;)
+
+    while(current_node->left_branch_ != nullptr)
+    {
+        AVL_STATS(++stats_.visited_nodes_;)
+        current_node = current_node->left_branch_;
+    }
 
     return current_node->value_;
 }
 
-template<typename T>
-T AVL_tree<T>::max() const
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+T AVL_tree<T, Compare, Allocator, Aggregate>::max() const
 {
-    Node<T> * current_node = root;
+    Node<T, Aggregate> * current_node = root;
+    AVL_STATS(++stats_.descents_;)
 
     while(current_node->right_branch_ != nullptr)
+    {
+        AVL_STATS(++stats_.visited_nodes_;)
         current_node = current_node->right_branch_;
+    }
 
     return current_node->value_;
 }
 
-template<typename T>
-std::ostream & operator<<(std::ostream & os, const Node<T> * node)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+Frozen_AVL_tree<T, Compare> AVL_tree<T, Compare, Allocator, Aggregate>::freeze() const
 {
-    if (node != nullptr)
+    if (root == nullptr)
+    {
+        return Frozen_AVL_tree<T, Compare>(comp_);
+    }
+
+    return Frozen_AVL_tree<T, Compare>(begin(), size(), comp_);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::save(const char * path, std::uint32_t log_epoch) const
+{
+    return save_snapshot<T>(path, begin(), size(), log_epoch);
+}
+
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+bool AVL_tree<T, Compare, Allocator, Aggregate>::load(const char * path, std::uint32_t * log_epoch)
+{
+    std::vector<T> keys;
+
+    if (!load_snapshot(path, keys, log_epoch))
+    {
+        return false;
+    }
+
+    assign(keys.begin(), keys.end());
+
+    return true;
+}
+
+template<typename T, typename Aggregate>
+std::ostream & operator<<(std::ostream & os, const Node<T, Aggregate> * node)
+{
+    if (node == nullptr)
+    {
+        return os;
+    }
+
+    // in-order walk by parent pointers, it stops when it goes out of the branch
+    const Node<T, Aggregate> * top = node->parent_;
+
+    while (node->left_branch_ != nullptr)
+        node = node->left_branch_;
+
+    while (node != top)
     {
-        operator<<(os, node->left_branch_);
         os << node->value_ << ' ';
-        operator<<(os, node->right_branch_);
+
+        if (node->right_branch_ != nullptr)
+        {
+            node = node->right_branch_;
+
+            while (node->left_branch_ != nullptr)
+                node = node->left_branch_;
+        }
+        else
+        {
+            const Node<T, Aggregate> * child;
+
+            do
+            {
+                child = node;
+                node = node->parent_;
+            } while (node != top && node->right_branch_ == child);
+        }
     }
+
     return os;
 }
 
-template<typename T>
-std::ostream & operator<<(std::ostream & os, const AVL_tree<T> & tree)
+template<typename T, typename Compare, typename Allocator, typename Aggregate>
+std::ostream & operator<<(std::ostream & os, const AVL_tree<T, Compare, Allocator, Aggregate> & tree)
 {
     os << tree.root;
 
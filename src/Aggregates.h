@@ -0,0 +1,62 @@
+#ifndef AGGREGATES_H_
+#define AGGREGATES_H_
+
+#include <limits>
+
+// Policies of values which every node of AVL_tree keeps for its subtree.
+// A policy is a monoid over the elements in sorted order:
+//     value_type           type of the value of a subtree
+//     identity()           value of an empty subtree
+//     of(value, count)     value of count copies of one element
+//     combine(left, right) value of left elements followed by right elements, it has to be associative
+// Rotations keep the order of elements, so combine does not have to be commutative.
+
+// nothing is kept, the node has no extra field
+template<typename T>
+struct No_aggregate
+{
+    struct value_type {};
+    static value_type identity() { return value_type(); }
+    static value_type of(const T &, int) { return value_type(); }
+    static value_type combine(const value_type &, const value_type &) { return value_type(); }
+};
+
+// quantity of elements, it is the same as elements_ which the tree keeps for order statistics
+template<typename T>
+struct Count_aggregate
+{
+    using value_type = int;
+    static value_type identity() { return 0; }
+    static value_type of(const T &, int count) { return count; }
+    static value_type combine(const value_type & left, const value_type & right) { return left + right; }
+};
+
+// sum of elements, Sum can be wider than T to avoid overflow
+template<typename T, typename Sum = T>
+struct Sum_aggregate
+{
+    using value_type = Sum;
+    static value_type identity() { return Sum(); }
+    static value_type of(const T & value, int count) { return static_cast<Sum>(value) * count; }
+    static value_type combine(const value_type & left, const value_type & right) { return left + right; }
+};
+
+template<typename T>
+struct Min_aggregate
+{
+    using value_type = T;
+    static value_type identity() { return std::numeric_limits<T>::max(); }
+    static value_type of(const T & value, int) { return value; }
+    static value_type combine(const value_type & left, const value_type & right) { return right < left ? right : left; }
+};
+
+template<typename T>
+struct Max_aggregate
+{
+    using value_type = T;
+    static value_type identity() { return std::numeric_limits<T>::lowest(); }
+    static value_type of(const T & value, int) { return value; }
+    static value_type combine(const value_type & left, const value_type & right) { return left < right ? right : left; }
+};
+
+#endif
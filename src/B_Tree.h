@@ -0,0 +1,1161 @@
+#ifndef B_TREE_H_
+#define B_TREE_H_
+
+#include <iostream>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include "Node_Pool.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// bits of the first count lanes of a mask
+inline std::uint64_t b_tree_lanes(int count)
+{
+    return count >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1;
+}
+
+// Search of a key among sorted keys of one node of B_tree.
+// count_less is the quantity of keys which are less than item, count_not_greater is
+// the quantity of keys which are not greater than item.
+template<typename T, typename Compare>
+struct B_tree_search
+{
+    static int count_less(const T * keys, int count, const T & item, const Compare & comp)
+    {
+        return static_cast<int>(std::lower_bound(keys, keys + count, item, comp) - keys);
+    }
+    static int count_not_greater(const T * keys, int count, const T & item, const Compare & comp)
+    {
+        return static_cast<int>(std::upper_bound(keys, keys + count, item, comp) - keys);
+    }
+};
+
+#if defined(__SSE2__)
+// int keys are compared with item by 8 (AVX2) or 4 (SSE2) at once without branches,
+// the masks of the comparisons are counted by popcount. Loads can go after count,
+// capacities of nodes are multiples of 8 and keys there are only not counted.
+template<>
+struct B_tree_search<int, std::less<int>>
+{
+    // bit j is set if keys[j] < item
+    static std::uint64_t less_mask(const int * keys, int count, int item)
+    {
+        std::uint64_t mask = 0;
+#if defined(__AVX2__)
+        __m256i x = _mm256_set1_epi32(item);
+
+        for (int j = 0; j < count; j += 8)
+        {
+            __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + j));
+            mask |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, k)))) << j;
+        }
+#else
+        __m128i x = _mm_set1_epi32(item);
+
+        for (int j = 0; j < count; j += 4)
+        {
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + j));
+            mask |= static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(k, x)))) << j;
+        }
+#endif
+        return mask & b_tree_lanes(count);
+    }
+    // bit j is set if keys[j] > item
+    static std::uint64_t greater_mask(const int * keys, int count, int item)
+    {
+        std::uint64_t mask = 0;
+#if defined(__AVX2__)
+        __m256i x = _mm256_set1_epi32(item);
+
+        for (int j = 0; j < count; j += 8)
+        {
+            __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + j));
+            mask |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, x)))) << j;
+        }
+#else
+        __m128i x = _mm_set1_epi32(item);
+
+        for (int j = 0; j < count; j += 4)
+        {
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + j));
+            mask |= static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, x)))) << j;
+        }
+#endif
+        return mask & b_tree_lanes(count);
+    }
+    static int count_less(const int * keys, int count, const int & item, const std::less<int> &)
+    {
+        return std::popcount(less_mask(keys, count, item));
+    }
+    static int count_not_greater(const int * keys, int count, const int & item, const std::less<int> &)
+    {
+        return count - std::popcount(greater_mask(keys, count, item));
+    }
+};
+#endif
+
+// Quantities of elements in children of an inner node of B_tree, they are one cache line.
+struct B_tree_sizes
+{
+    static const int capacity_ = 16; // children of an inner node
+    // the child which keeps the i-th element of the node, i becomes the number of the element in the child
+    static int child_of_rank(const int * sizes, int count, int & i)
+    {
+#if defined(__SSE2__)
+        // prefix sums by shifts and adds in lanes, the sum of the previous lanes is added as carry,
+        // then the child is the quantity of prefix sums which are less than i
+        alignas(32) int prefix[capacity_];
+        std::uint64_t mask = 0;
+#if defined(__AVX2__)
+        __m256i rank = _mm256_set1_epi32(i);
+        __m256i carry = _mm256_setzero_si256();
+
+        for (int j = 0; j < count; j += 8)
+        {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sizes + j));
+            x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+            x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+            // the sum of the low half goes to the high half
+            __m256i low = _mm256_shuffle_epi32(x, 0xFF);
+            x = _mm256_add_epi32(x, _mm256_permute2x128_si256(low, low, 0x08));
+            x = _mm256_add_epi32(x, carry);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(prefix + j), x);
+            mask |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(rank, x)))) << j;
+            carry = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+        }
+#else
+        __m128i rank = _mm_set1_epi32(i);
+        __m128i carry = _mm_setzero_si128();
+
+        for (int j = 0; j < count; j += 4)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sizes + j));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi32(x, carry);
+            _mm_store_si128(reinterpret_cast<__m128i *>(prefix + j), x);
+            mask |= static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(x, rank)))) << j;
+            carry = _mm_shuffle_epi32(x, 0xFF);
+        }
+#endif
+        int child = std::popcount(mask & b_tree_lanes(count));
+
+        if (child > 0)
+        {
+            i -= prefix[child - 1];
+        }
+
+        return child;
+#else
+        int child = 0;
+
+        while (i > sizes[child])
+            i -= sizes[child++];
+
+        return child;
+#endif
+    }
+    // quantity of elements in the first count children
+    static int sum(const int * sizes, int count)
+    {
+        int result = 0;
+
+        for (int j = 0; j < count; ++j)
+            result += sizes[j];
+
+        return result;
+    }
+};
+
+// B+ tree with the same interface as AVL_tree for insert, remove, search, order statistics and iteration.
+// Elements are kept in leaves of 128 bytes which are linked in a list for iterators,
+// an inner node keeps up to 16 children with quantities of elements in them, so an order
+// statistic is found by prefix sums of the quantities. Nodes are aligned to cache lines,
+// a descent reads a few lines per level instead of a node per comparison.
+template<typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>>
+class B_tree
+{
+    private:
+        static const int cache_line_ = 64;
+        static const int inner_capacity_ = B_tree_sizes::capacity_;
+        static const int inner_min_ = inner_capacity_ / 2;
+        // keys of a leaf are two cache lines, a multiple of 8 for vector loads of int
+        static const int leaf_capacity_ = 2 * cache_line_ / sizeof(T) >= 8 ? 2 * cache_line_ / sizeof(T) / 8 * 8 : 4;
+        static const int leaf_min_ = leaf_capacity_ / 2;
+        // a node below the root has at least inner_min_ children, it is less than 12 levels for 2^31 elements
+        static const int max_height_ = 32;
+        struct alignas(cache_line_) Leaf
+        {
+            T keys_[leaf_capacity_] {};
+            int count_ = 0;
+            Leaf * previous_ = nullptr;
+            Leaf * next_ = nullptr;
+        };
+        // keys_[j] is greater than the elements of child j and not greater than the elements of child j + 1
+        struct alignas(cache_line_) Inner
+        {
+            int sizes_[inner_capacity_] {}; // quantity of elements in every child
+            T keys_[inner_capacity_] {};    // count_ - 1 keys are used, the last place is for vector loads
+            void * children_[inner_capacity_] {}; // leaves on the lowest inner level and inner nodes above it
+            int count_ = 0; // quantity of children
+        };
+        using search = B_tree_search<T, Compare>;
+        using leaf_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Leaf>;
+        using leaf_traits = std::allocator_traits<leaf_allocator>;
+        using inner_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Inner>;
+        using inner_traits = std::allocator_traits<inner_allocator>;
+        void * root_; // a leaf if height_ is 0
+        int height_;  // quantity of inner levels
+        int size_;
+        Leaf * first_; // leaves with the min and the max elements, iterators begin and end there
+        Leaf * last_;
+        leaf_allocator allocator_; // inner nodes are taken from a rebound copy, it is equal to this one
+        [[no_unique_address]] Compare comp_;
+        bool quiet_; // count duplicates instead of a message about every one
+        std::size_t duplicates_;
+        Leaf * create_leaf();
+        Inner * create_inner();
+        void destroy_leaf(Leaf * leaf);
+        void destroy_inner(Inner * inner);
+        void delete_nodes(void * node, int level); // level is the quantity of inner levels from node
+        void delete_all();
+        void * copy_nodes(const void * node, int level, Leaf * & previous); // leaves are linked after previous
+        void copy_tree(const B_tree<T, Compare, Allocator> & tree);
+        void count_duplicate(const T & item);
+        // the leaf where item is or has to be, path[j] is the inner node of level j and children[j] is its child on the way
+        Leaf * find_leaf(const T & item, Inner * path[], int children[]) const;
+        // a new node right goes after the node of level in the path, sizes are the quantities of both nodes
+        void add_child(Inner * path[], const int children[], int level, int left_size, T key, void * right, int right_size);
+        void insert_child(Inner * node, int position, const T & key, void * child, int size); // key goes before the child
+        void remove_child(Inner * node, int position); // the child and the key before it
+        Leaf * split_leaf(Leaf * leaf, Leaf * & item_leaf, int & index, const T & item); // item goes to index of item_leaf
+        void merge_leaves(Leaf * left, Leaf * right);
+        void rebalance_leaf(Inner * path[], const int children[], Leaf * leaf);
+        void rebalance_inner(Inner * path[], const int children[], int level);
+    public:
+        B_tree();
+        explicit B_tree(const Allocator & allocator);
+        explicit B_tree(const Compare & comp, const Allocator & allocator = Allocator());
+        template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        B_tree(InputIt first, InputIt last, const Compare & comp = Compare(), const Allocator & allocator = Allocator());
+        B_tree(const B_tree<T, Compare, Allocator> & tree);
+        B_tree(B_tree<T, Compare, Allocator> && tree);
+        ~B_tree();
+        B_tree<T, Compare, Allocator> & operator=(const B_tree<T, Compare, Allocator> & tree);
+        B_tree<T, Compare, Allocator> & operator=(B_tree<T, Compare, Allocator> && tree);
+        bool is_there(const T & item) const;
+        void remove(const T & item);
+        int size() const;
+        Allocator get_allocator() const;
+        Compare key_comp() const;
+        void set_quiet(bool quiet);
+        std::size_t duplicates() const; // quantity of values which were already in the tree
+        T k_th_order_statistic(int i) const;
+        int elem_less_than(const T & item) const;
+        T min() const;
+        T max() const;
+
+        // bidirectional iterator, it goes through the list of leaves
+        class iterator
+        {
+            friend class B_tree;
+            private:
+                const B_tree<T, Compare, Allocator> * tree_; // it is needed to step back from the end
+                const Leaf * leaf_; // nullptr is the end of the container
+                int index_;
+                iterator(const B_tree<T, Compare, Allocator> * tree, const Leaf * leaf, int index) : tree_(tree),
+                                                                                                    leaf_(leaf),
+                                                                                                    index_(index) {}
+            public:
+                using iterator_category = std::bidirectional_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const T *;
+                using reference = const T &;
+                iterator() : tree_(nullptr), leaf_(nullptr), index_(0) {}
+                const T & operator*() const
+                {
+                    return leaf_->keys_[index_];
+                }
+                const T * operator->() const
+                {
+                    return &**this;
+                }
+                bool operator==(const iterator & it) const
+                {
+                    return tree_ == it.tree_ && leaf_ == it.leaf_ && index_ == it.index_;
+                }
+                bool operator!=(const iterator & it) const
+                {
+                    return !(*this == it);
+                }
+                iterator & operator++()
+                {
+                    // the end stays the end
+                    if (leaf_ != nullptr && ++index_ == leaf_->count_)
+                    {
+                        leaf_ = leaf_->next_;
+                        index_ = 0;
+                    }
+                    return *this;
+                }
+                iterator operator++(int)
+                {
+                    iterator it = *this;
+                    ++(*this);
+                    return it;
+                }
+                iterator & operator--()
+                {
+                    // the end goes to the max element, the first element stays the first
+                    if (leaf_ == nullptr)
+                    {
+                        leaf_ = tree_->last_;
+                        index_ = leaf_ != nullptr ? leaf_->count_ - 1 : 0;
+                    }
+                    else if (index_ > 0)
+                    {
+                        --index_;
+                    }
+                    else if (leaf_->previous_ != nullptr)
+                    {
+                        leaf_ = leaf_->previous_;
+                        index_ = leaf_->count_ - 1;
+                    }
+                    return *this;
+                }
+                iterator operator--(int)
+                {
+                    iterator it = *this;
+                    --(*this);
+                    return it;
+                }
+        };
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        // the iterator points to the new element or to the element which was already there
+        std::pair<iterator, bool> insert(const T & item);
+        iterator begin() const
+        {
+            return iterator(this, first_, 0); // from min to max
+        }
+        iterator end() const
+        {
+            return iterator(this, nullptr, 0);
+        }
+        reverse_iterator rbegin() const
+        {
+            return reverse_iterator(end()); // from max to min
+        }
+        reverse_iterator rend() const
+        {
+            return reverse_iterator(begin());
+        }
+};
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator>::B_tree()
+{
+    root_ = nullptr;
+    height_ = 0;
+    size_ = 0;
+    first_ = nullptr;
+    last_ = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
+}
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator>::B_tree(const Allocator & allocator) : allocator_(allocator)
+{
+    root_ = nullptr;
+    height_ = 0;
+    size_ = 0;
+    first_ = nullptr;
+    last_ = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
+}
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator>::B_tree(const Compare & comp, const Allocator & allocator) : allocator_(allocator),
+                                                                                          comp_(comp)
+{
+    root_ = nullptr;
+    height_ = 0;
+    size_ = 0;
+    first_ = nullptr;
+    last_ = nullptr;
+    quiet_ = false;
+    duplicates_ = 0;
+}
+
+template<typename T, typename Compare, typename Allocator>
+template<typename InputIt, typename>
+B_tree<T, Compare, Allocator>::B_tree(InputIt first, InputIt last, const Compare & comp, const Allocator & allocator)
+    : B_tree(comp, allocator)
+{
+    quiet_ = true;
+
+    for (; first != last; ++first)
+        insert(*first);
+
+    quiet_ = false;
+}
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator>::B_tree(const B_tree<T, Compare, Allocator> & tree)
+    : allocator_(leaf_traits::select_on_container_copy_construction(tree.allocator_)),
+      comp_(tree.comp_)
+{
+    root_ = nullptr;
+    height_ = 0;
+    size_ = 0;
+    first_ = nullptr;
+    last_ = nullptr;
+    copy_tree(tree);
+    quiet_ = tree.quiet_;
+    duplicates_ = 0;
+}
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator>::B_tree(B_tree<T, Compare, Allocator> && tree) : root_(tree.root_),
+                                                                               height_(tree.height_),
+                                                                               size_(tree.size_),
+                                                                               first_(tree.first_),
+                                                                               last_(tree.last_),
+                                                                               allocator_(std::move(tree.allocator_)),
+                                                                               comp_(tree.comp_),
+                                                                               quiet_(tree.quiet_),
+                                                                               duplicates_(tree.duplicates_)
+{
+    tree.root_ = nullptr;
+    tree.height_ = 0;
+    tree.size_ = 0;
+    tree.first_ = nullptr;
+    tree.last_ = nullptr;
+
+    if constexpr (is_node_pool<leaf_allocator>::value)
+    {
+        // the empty tree does not share the arenas, so this tree can free them at once
+        tree.allocator_ = leaf_allocator();
+    }
+}
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator>::~B_tree()
+{
+    if constexpr (is_node_pool<leaf_allocator>::value && std::is_trivially_destructible<T>::value)
+    {
+        // nodes need no destructors, so blocks of the pool are freed without visiting nodes
+        if (allocator_.release())
+        {
+            return;
+        }
+    }
+
+    delete_all();
+}
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator> & B_tree<T, Compare, Allocator>::operator=(const B_tree<T, Compare, Allocator> & tree)
+{
+    if (this != &tree)
+    {
+        delete_all();
+        comp_ = tree.comp_;
+
+        if constexpr (leaf_traits::propagate_on_container_copy_assignment::value)
+        {
+            allocator_ = tree.allocator_;
+        }
+
+        copy_tree(tree);
+    }
+
+    return *this;
+}
+
+template<typename T, typename Compare, typename Allocator>
+B_tree<T, Compare, Allocator> & B_tree<T, Compare, Allocator>::operator=(B_tree<T, Compare, Allocator> && tree)
+{
+    if (this == &tree)
+    {
+        return *this;
+    }
+
+    delete_all();
+    comp_ = tree.comp_;
+
+    if constexpr (leaf_traits::propagate_on_container_move_assignment::value)
+    {
+        allocator_ = std::move(tree.allocator_);
+
+        if constexpr (is_node_pool<leaf_allocator>::value)
+        {
+            tree.allocator_ = leaf_allocator();
+        }
+    }
+    else if (allocator_ != tree.allocator_)
+    {
+        // nodes of the other tree can not be freed by this allocator
+        copy_tree(tree);
+        return *this;
+    }
+
+    root_ = tree.root_;
+    height_ = tree.height_;
+    size_ = tree.size_;
+    first_ = tree.first_;
+    last_ = tree.last_;
+    tree.root_ = nullptr;
+    tree.height_ = 0;
+    tree.size_ = 0;
+    tree.first_ = nullptr;
+    tree.last_ = nullptr;
+
+    return *this;
+}
+
+template<typename T, typename Compare, typename Allocator>
+typename B_tree<T, Compare, Allocator>::Leaf * B_tree<T, Compare, Allocator>::create_leaf()
+{
+    Leaf * leaf = leaf_traits::allocate(allocator_, 1);
+
+    try
+    {
+        leaf_traits::construct(allocator_, leaf);
+    }
+    catch (...)
+    {
+        leaf_traits::deallocate(allocator_, leaf, 1);
+        throw;
+    }
+
+    return leaf;
+}
+
+template<typename T, typename Compare, typename Allocator>
+typename B_tree<T, Compare, Allocator>::Inner * B_tree<T, Compare, Allocator>::create_inner()
+{
+    // inner nodes are rare, so the allocator is rebound for every one
+    inner_allocator allocator(allocator_);
+    Inner * inner = inner_traits::allocate(allocator, 1);
+
+    try
+    {
+        inner_traits::construct(allocator, inner);
+    }
+    catch (...)
+    {
+        inner_traits::deallocate(allocator, inner, 1);
+        throw;
+    }
+
+    return inner;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::destroy_leaf(Leaf * leaf)
+{
+    leaf_traits::destroy(allocator_, leaf);
+    leaf_traits::deallocate(allocator_, leaf, 1);
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::destroy_inner(Inner * inner)
+{
+    inner_allocator allocator(allocator_);
+    inner_traits::destroy(allocator, inner);
+    inner_traits::deallocate(allocator, inner, 1);
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::delete_nodes(void * node, int level)
+{
+    if (level == 0)
+    {
+        destroy_leaf(static_cast<Leaf *>(node));
+        return;
+    }
+
+    Inner * inner = static_cast<Inner *>(node);
+
+    for (int j = 0; j < inner->count_; ++j)
+        delete_nodes(inner->children_[j], level - 1);
+
+    destroy_inner(inner);
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::delete_all()
+{
+    if (root_ != nullptr)
+    {
+        delete_nodes(root_, height_);
+    }
+
+    root_ = nullptr;
+    height_ = 0;
+    size_ = 0;
+    first_ = nullptr;
+    last_ = nullptr;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void * B_tree<T, Compare, Allocator>::copy_nodes(const void * node, int level, Leaf * & previous)
+{
+    if (level == 0)
+    {
+        const Leaf * other = static_cast<const Leaf *>(node);
+        Leaf * leaf = create_leaf();
+        std::copy(other->keys_, other->keys_ + other->count_, leaf->keys_);
+        leaf->count_ = other->count_;
+
+        // leaves are made from min to max
+        leaf->previous_ = previous;
+
+        if (previous != nullptr)
+        {
+            previous->next_ = leaf;
+        }
+        else
+        {
+            first_ = leaf;
+        }
+
+        previous = leaf;
+        last_ = leaf;
+
+        return leaf;
+    }
+
+    const Inner * other = static_cast<const Inner *>(node);
+    Inner * inner = create_inner();
+    std::copy(other->keys_, other->keys_ + other->count_ - 1, inner->keys_);
+    std::copy(other->sizes_, other->sizes_ + other->count_, inner->sizes_);
+
+    for (int j = 0; j < other->count_; ++j)
+    {
+        inner->children_[j] = copy_nodes(other->children_[j], level - 1, previous);
+        inner->count_ = j + 1;
+    }
+
+    return inner;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::copy_tree(const B_tree<T, Compare, Allocator> & tree)
+{
+    if (tree.root_ == nullptr)
+    {
+        return;
+    }
+
+    Leaf * previous = nullptr;
+    root_ = copy_nodes(tree.root_, tree.height_, previous);
+    height_ = tree.height_;
+    size_ = tree.size_;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::count_duplicate(const T & item)
+{
+    ++duplicates_;
+
+    if constexpr (requires { std::cerr << item; })
+    {
+        if (!quiet_)
+        {
+            std::cerr << "\nValue " << item << " is already in the tree" << std::endl;
+        }
+    }
+}
+
+template<typename T, typename Compare, typename Allocator>
+typename B_tree<T, Compare, Allocator>::Leaf * B_tree<T, Compare, Allocator>::find_leaf(const T & item, Inner * path[], int children[]) const
+{
+    void * node = root_;
+
+    for (int level = 0; level < height_; ++level)
+    {
+        Inner * inner = static_cast<Inner *>(node);
+        path[level] = inner;
+        children[level] = search::count_not_greater(inner->keys_, inner->count_ - 1, item, comp_);
+        node = inner->children_[children[level]];
+    }
+
+    return static_cast<Leaf *>(node);
+}
+
+template<typename T, typename Compare, typename Allocator>
+std::pair<typename B_tree<T, Compare, Allocator>::iterator, bool> B_tree<T, Compare, Allocator>::insert(const T & item)
+{
+    if (root_ == nullptr)
+    {
+        Leaf * leaf = create_leaf();
+        leaf->keys_[0] = item;
+        leaf->count_ = 1;
+        root_ = leaf;
+        first_ = leaf;
+        last_ = leaf;
+        size_ = 1;
+
+        return {iterator(this, leaf, 0), true};
+    }
+
+    Inner * path[max_height_];
+    int children[max_height_];
+    Leaf * leaf = find_leaf(item, path, children);
+    int index = search::count_less(leaf->keys_, leaf->count_, item, comp_);
+
+    if (index < leaf->count_ && !comp_(item, leaf->keys_[index]))
+    {
+        count_duplicate(item);
+
+        return {iterator(this, leaf, index), false};
+    }
+
+    if (leaf->count_ < leaf_capacity_)
+    {
+        std::move_backward(leaf->keys_ + index, leaf->keys_ + leaf->count_, leaf->keys_ + leaf->count_ + 1);
+        leaf->keys_[index] = item;
+        ++leaf->count_;
+
+        for (int level = 0; level < height_; ++level)
+            ++path[level]->sizes_[children[level]];
+        ++size_;
+
+        return {iterator(this, leaf, index), true};
+    }
+
+    Leaf * item_leaf = leaf;
+    Leaf * right = split_leaf(leaf, item_leaf, index, item);
+
+    // quantities above the parent of the leaf grow by the item, the parent gets both leaves
+    for (int level = 0; level + 1 < height_; ++level)
+        ++path[level]->sizes_[children[level]];
+    ++size_;
+
+    add_child(path, children, height_, leaf->count_, right->keys_[0], right, right->count_);
+
+    return {iterator(this, item_leaf, index), true};
+}
+
+template<typename T, typename Compare, typename Allocator>
+typename B_tree<T, Compare, Allocator>::Leaf * B_tree<T, Compare, Allocator>::split_leaf(Leaf * leaf, Leaf * & item_leaf, int & index, const T & item)
+{
+    Leaf * right = create_leaf();
+    // leaf_capacity_ + 1 keys with item, the first left_count of them stay in leaf
+    int left_count = (leaf_capacity_ + 1) / 2;
+
+    if (index < left_count)
+    {
+        std::move(leaf->keys_ + left_count - 1, leaf->keys_ + leaf_capacity_, right->keys_);
+        std::move_backward(leaf->keys_ + index, leaf->keys_ + left_count - 1, leaf->keys_ + left_count);
+        leaf->keys_[index] = item;
+    }
+    else
+    {
+        int position = index - left_count;
+        std::move(leaf->keys_ + left_count, leaf->keys_ + index, right->keys_);
+        right->keys_[position] = item;
+        std::move(leaf->keys_ + index, leaf->keys_ + leaf_capacity_, right->keys_ + position + 1);
+        item_leaf = right;
+        index = position;
+    }
+
+    leaf->count_ = left_count;
+    right->count_ = leaf_capacity_ + 1 - left_count;
+    right->previous_ = leaf;
+    right->next_ = leaf->next_;
+
+    if (leaf->next_ != nullptr)
+    {
+        leaf->next_->previous_ = right;
+    }
+    else
+    {
+        last_ = right;
+    }
+
+    leaf->next_ = right;
+
+    return right;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::insert_child(Inner * node, int position, const T & key, void * child, int size)
+{
+    std::move_backward(node->keys_ + position - 1, node->keys_ + node->count_ - 1, node->keys_ + node->count_);
+    std::copy_backward(node->children_ + position, node->children_ + node->count_, node->children_ + node->count_ + 1);
+    std::copy_backward(node->sizes_ + position, node->sizes_ + node->count_, node->sizes_ + node->count_ + 1);
+    node->keys_[position - 1] = key;
+    node->children_[position] = child;
+    node->sizes_[position] = size;
+    ++node->count_;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::remove_child(Inner * node, int position)
+{
+    std::move(node->keys_ + position, node->keys_ + node->count_ - 1, node->keys_ + position - 1);
+    std::copy(node->children_ + position + 1, node->children_ + node->count_, node->children_ + position);
+    std::copy(node->sizes_ + position + 1, node->sizes_ + node->count_, node->sizes_ + position);
+    --node->count_;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::add_child(Inner * path[], const int children[], int level, int left_size, T key, void * right, int right_size)
+{
+    while (level > 0)
+    {
+        Inner * parent = path[level - 1];
+        int child = children[level - 1];
+        parent->sizes_[child] = left_size;
+
+        if (parent->count_ < inner_capacity_)
+        {
+            insert_child(parent, child + 1, key, right, right_size);
+            return;
+        }
+
+        // the full node and the new child make inner_capacity_ + 1 children, they are divided between two nodes
+        T keys[inner_capacity_];
+        void * nodes[inner_capacity_ + 1];
+        int sizes[inner_capacity_ + 1];
+        int position = child + 1;
+
+        std::move(parent->keys_, parent->keys_ + position - 1, keys);
+        keys[position - 1] = std::move(key);
+        std::move(parent->keys_ + position - 1, parent->keys_ + inner_capacity_ - 1, keys + position);
+        std::copy(parent->children_, parent->children_ + position, nodes);
+        nodes[position] = right;
+        std::copy(parent->children_ + position, parent->children_ + inner_capacity_, nodes + position + 1);
+        std::copy(parent->sizes_, parent->sizes_ + position, sizes);
+        sizes[position] = right_size;
+        std::copy(parent->sizes_ + position, parent->sizes_ + inner_capacity_, sizes + position + 1);
+
+        Inner * sibling = create_inner();
+        int left_count = (inner_capacity_ + 1) / 2;
+
+        std::move(keys, keys + left_count - 1, parent->keys_);
+        std::copy(nodes, nodes + left_count, parent->children_);
+        std::copy(sizes, sizes + left_count, parent->sizes_);
+        parent->count_ = left_count;
+        std::move(keys + left_count, keys + inner_capacity_, sibling->keys_);
+        std::copy(nodes + left_count, nodes + inner_capacity_ + 1, sibling->children_);
+        std::copy(sizes + left_count, sizes + inner_capacity_ + 1, sibling->sizes_);
+        sibling->count_ = inner_capacity_ + 1 - left_count;
+
+        // the middle key goes up to the parent of both nodes
+        key = std::move(keys[left_count - 1]);
+        left_size = B_tree_sizes::sum(parent->sizes_, parent->count_);
+        right = sibling;
+        right_size = B_tree_sizes::sum(sibling->sizes_, sibling->count_);
+        --level;
+    }
+
+    // the root is divided, the tree grows by a level
+    Inner * new_root = create_inner();
+    new_root->children_[0] = root_;
+    new_root->children_[1] = right;
+    new_root->sizes_[0] = left_size;
+    new_root->sizes_[1] = right_size;
+    new_root->keys_[0] = std::move(key);
+    new_root->count_ = 2;
+    root_ = new_root;
+    ++height_;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::remove(const T & item)
+{
+    Inner * path[max_height_];
+    int children[max_height_];
+    Leaf * leaf = root_ != nullptr ? find_leaf(item, path, children) : nullptr;
+    int index = leaf != nullptr ? search::count_less(leaf->keys_, leaf->count_, item, comp_) : 0;
+
+    if (leaf == nullptr || index == leaf->count_ || comp_(item, leaf->keys_[index]))
+    {
+        if constexpr (requires { std::cerr << item; })
+        {
+            std::cerr << "\nThere isn`t " << item << " in the tree." << std::endl;
+        }
+        return;
+    }
+
+    std::move(leaf->keys_ + index + 1, leaf->keys_ + leaf->count_, leaf->keys_ + index);
+    --leaf->count_;
+
+    for (int level = 0; level < height_; ++level)
+        --path[level]->sizes_[children[level]];
+    --size_;
+
+    if (height_ == 0)
+    {
+        if (leaf->count_ == 0)
+        {
+            delete_all();
+        }
+        return;
+    }
+
+    if (leaf->count_ < leaf_min_)
+    {
+        rebalance_leaf(path, children, leaf);
+    }
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::merge_leaves(Leaf * left, Leaf * right)
+{
+    std::move(right->keys_, right->keys_ + right->count_, left->keys_ + left->count_);
+    left->count_ += right->count_;
+    left->next_ = right->next_;
+
+    if (right->next_ != nullptr)
+    {
+        right->next_->previous_ = left;
+    }
+    else
+    {
+        last_ = left;
+    }
+
+    destroy_leaf(right);
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::rebalance_leaf(Inner * path[], const int children[], Leaf * leaf)
+{
+    Inner * parent = path[height_ - 1];
+    int child = children[height_ - 1];
+    Leaf * left = child > 0 ? static_cast<Leaf *>(parent->children_[child - 1]) : nullptr;
+    Leaf * right = child + 1 < parent->count_ ? static_cast<Leaf *>(parent->children_[child + 1]) : nullptr;
+
+    if (left != nullptr && left->count_ > leaf_min_)
+    {
+        // the max key of the left neighbour
+        std::move_backward(leaf->keys_, leaf->keys_ + leaf->count_, leaf->keys_ + leaf->count_ + 1);
+        leaf->keys_[0] = std::move(left->keys_[left->count_ - 1]);
+        --left->count_;
+        ++leaf->count_;
+        parent->keys_[child - 1] = leaf->keys_[0];
+        --parent->sizes_[child - 1];
+        ++parent->sizes_[child];
+    }
+    else if (right != nullptr && right->count_ > leaf_min_)
+    {
+        // the min key of the right neighbour
+        leaf->keys_[leaf->count_] = std::move(right->keys_[0]);
+        std::move(right->keys_ + 1, right->keys_ + right->count_, right->keys_);
+        --right->count_;
+        ++leaf->count_;
+        parent->keys_[child] = right->keys_[0];
+        ++parent->sizes_[child];
+        --parent->sizes_[child + 1];
+    }
+    else
+    {
+        // both leaves fit in one, the right one is removed from the parent
+        int position = left != nullptr ? child : child + 1;
+
+        if (left != nullptr)
+        {
+            merge_leaves(left, leaf);
+        }
+        else
+        {
+            merge_leaves(leaf, right);
+        }
+
+        parent->sizes_[position - 1] += parent->sizes_[position];
+        remove_child(parent, position);
+        rebalance_inner(path, children, height_ - 1);
+    }
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::rebalance_inner(Inner * path[], const int children[], int level)
+{
+    while (level > 0 && path[level]->count_ < inner_min_)
+    {
+        Inner * node = path[level];
+        Inner * parent = path[level - 1];
+        int child = children[level - 1];
+        Inner * left = child > 0 ? static_cast<Inner *>(parent->children_[child - 1]) : nullptr;
+        Inner * right = child + 1 < parent->count_ ? static_cast<Inner *>(parent->children_[child + 1]) : nullptr;
+
+        if (left != nullptr && left->count_ > inner_min_)
+        {
+            // the last child of the left neighbour goes through the parent key
+            int moved = left->sizes_[left->count_ - 1];
+            std::move_backward(node->keys_, node->keys_ + node->count_ - 1, node->keys_ + node->count_);
+            std::copy_backward(node->children_, node->children_ + node->count_, node->children_ + node->count_ + 1);
+            std::copy_backward(node->sizes_, node->sizes_ + node->count_, node->sizes_ + node->count_ + 1);
+            node->keys_[0] = std::move(parent->keys_[child - 1]);
+            node->children_[0] = left->children_[left->count_ - 1];
+            node->sizes_[0] = moved;
+            ++node->count_;
+            parent->keys_[child - 1] = std::move(left->keys_[left->count_ - 2]);
+            --left->count_;
+            parent->sizes_[child - 1] -= moved;
+            parent->sizes_[child] += moved;
+            return;
+        }
+
+        if (right != nullptr && right->count_ > inner_min_)
+        {
+            // the first child of the right neighbour goes through the parent key
+            int moved = right->sizes_[0];
+            node->keys_[node->count_ - 1] = std::move(parent->keys_[child]);
+            node->children_[node->count_] = right->children_[0];
+            node->sizes_[node->count_] = moved;
+            ++node->count_;
+            parent->keys_[child] = std::move(right->keys_[0]);
+            std::move(right->keys_ + 1, right->keys_ + right->count_ - 1, right->keys_);
+            std::copy(right->children_ + 1, right->children_ + right->count_, right->children_);
+            std::copy(right->sizes_ + 1, right->sizes_ + right->count_, right->sizes_);
+            --right->count_;
+            parent->sizes_[child] += moved;
+            parent->sizes_[child + 1] -= moved;
+            return;
+        }
+
+        // both nodes fit in one, the parent key between them goes down
+        int position = left != nullptr ? child : child + 1;
+        Inner * first = left != nullptr ? left : node;
+        Inner * second = left != nullptr ? node : right;
+
+        first->keys_[first->count_ - 1] = std::move(parent->keys_[position - 1]);
+        std::move(second->keys_, second->keys_ + second->count_ - 1, first->keys_ + first->count_);
+        std::copy(second->children_, second->children_ + second->count_, first->children_ + first->count_);
+        std::copy(second->sizes_, second->sizes_ + second->count_, first->sizes_ + first->count_);
+        first->count_ += second->count_;
+        destroy_inner(second);
+        parent->sizes_[position - 1] += parent->sizes_[position];
+        remove_child(parent, position);
+        --level;
+    }
+
+    // the root with one child is removed, the tree becomes lower by a level
+    if (level == 0 && path[0]->count_ == 1)
+    {
+        root_ = path[0]->children_[0];
+        destroy_inner(path[0]);
+        --height_;
+    }
+}
+
+template<typename T, typename Compare, typename Allocator>
+bool B_tree<T, Compare, Allocator>::is_there(const T & item) const
+{
+    if (root_ == nullptr)
+    {
+        return false;
+    }
+
+    Inner * path[max_height_];
+    int children[max_height_];
+    Leaf * leaf = find_leaf(item, path, children);
+    int index = search::count_less(leaf->keys_, leaf->count_, item, comp_);
+
+    return index < leaf->count_ && !comp_(item, leaf->keys_[index]);
+}
+
+template<typename T, typename Compare, typename Allocator>
+int B_tree<T, Compare, Allocator>::size() const
+{
+    return size_;
+}
+
+template<typename T, typename Compare, typename Allocator>
+Allocator B_tree<T, Compare, Allocator>::get_allocator() const
+{
+    return Allocator(allocator_);
+}
+
+template<typename T, typename Compare, typename Allocator>
+Compare B_tree<T, Compare, Allocator>::key_comp() const
+{
+    return comp_;
+}
+
+template<typename T, typename Compare, typename Allocator>
+void B_tree<T, Compare, Allocator>::set_quiet(bool quiet)
+{
+    quiet_ = quiet;
+}
+
+template<typename T, typename Compare, typename Allocator>
+std::size_t B_tree<T, Compare, Allocator>::duplicates() const
+{
+    return duplicates_;
+}
+
+template<typename T, typename Compare, typename Allocator>
+T B_tree<T, Compare, Allocator>::k_th_order_statistic(int i) const
+{
+    if (i <= 0 || i > size_)
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return T();
+    }
+
+    void * node = root_;
+
+    for (int level = 0; level < height_; ++level)
+    {
+        Inner * inner = static_cast<Inner *>(node);
+        node = inner->children_[B_tree_sizes::child_of_rank(inner->sizes_, inner->count_, i)];
+    }
+
+    return static_cast<Leaf *>(node)->keys_[i - 1];
+}
+
+template<typename T, typename Compare, typename Allocator>
+int B_tree<T, Compare, Allocator>::elem_less_than(const T & item) const
+{
+    if (root_ == nullptr)
+    {
+        return 0;
+    }
+
+    // elements of the children before the child of item are less than it
+    int result = 0;
+    void * node = root_;
+
+    for (int level = 0; level < height_; ++level)
+    {
+        Inner * inner = static_cast<Inner *>(node);
+        int child = search::count_less(inner->keys_, inner->count_ - 1, item, comp_);
+        result += B_tree_sizes::sum(inner->sizes_, child);
+        node = inner->children_[child];
+    }
+
+    Leaf * leaf = static_cast<Leaf *>(node);
+
+    return result + search::count_less(leaf->keys_, leaf->count_, item, comp_);
+}
+
+template<typename T, typename Compare, typename Allocator>
+T B_tree<T, Compare, Allocator>::min() const
+{
+    return first_->keys_[0];
+}
+
+template<typename T, typename Compare, typename Allocator>
+T B_tree<T, Compare, Allocator>::max() const
+{
+    return last_->keys_[last_->count_ - 1];
+}
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef COMMAND_READER_H_
+#define COMMAND_READER_H_
+
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <poll.h>
+#include <unistd.h>
+
+struct Command
+{
+    char letter_;
+    int value_;
+    int missed_spaces_; // how many times a space was missed before this command
+};
+
+// Result of a command which is executed apart from writing of its output,
+// the output and messages are written later in the order of commands
+struct Command_result
+{
+    int value_;  // answer of 'm' or 'n'
+    bool done_;  // 'k' inserted a new element, 'm' had a correct number
+};
+
+// Reads commands like "k 8 m 1 n 3" from a file descriptor by big blocks.
+// It keeps the behaviour of the old std::cin loop: a missed space is reported
+// and the command is still executed, anything else stops the input.
+class Command_reader
+{
+    private:
+        static const std::size_t buffer_size_ = 1 << 20;
+        static const std::size_t max_number_length_ = 64;
+        int fd_;
+        std::unique_ptr<char[]> buffer_;
+        char * position_; // next unread character
+        char * end_;      // end of read characters
+        bool eof_;
+        bool fail_;       // like failbit of a stream: last reading was unsuccessful
+        bool finished_;
+        bool bad_input_;
+        char alpha_;
+        char space_;
+        bool fill(std::size_t n); // try to have at least n unread characters in buffer
+        void fill_number(); // read until the number is complete, so a command does not wait for the next ones
+        bool get(char & symbol);
+        bool read_int(int & value);
+        int read_digits(); // reading a number after a missed space
+        bool step(Command & command);
+    public:
+        explicit Command_reader(int fd);
+        Command_reader(const Command_reader & reader) = delete;
+        Command_reader & operator=(const Command_reader & reader) = delete;
+        bool next(Command & command); // false if there are no more commands
+        bool bad_input() const; // the input was stopped by an uncorrect symbol
+        bool buffered() const; // there are read characters which are not parsed yet
+        bool wait(int timeout); // false if nothing comes to the input for timeout milliseconds
+};
+
+inline Command_reader::Command_reader(int fd) : fd_(fd),
+                                                buffer_(new char[buffer_size_])
+{
+    position_ = buffer_.get();
+    end_ = buffer_.get();
+    eof_ = false;
+    fail_ = false;
+    finished_ = false;
+    bad_input_ = false;
+    alpha_ = ' ';
+    space_ = ' ';
+}
+
+inline bool Command_reader::fill(std::size_t n)
+{
+    if (static_cast<std::size_t>(end_ - position_) >= n)
+    {
+        return true;
+    }
+
+    // move the rest of characters to the beginning of the buffer
+    std::size_t rest = end_ - position_;
+    std::memmove(buffer_.get(), position_, rest);
+    position_ = buffer_.get();
+    end_ = buffer_.get() + rest;
+
+    while (!eof_ && static_cast<std::size_t>(end_ - position_) < n)
+    {
+        ssize_t count = ::read(fd_, end_, buffer_.get() + buffer_size_ - end_);
+
+        if (count > 0)
+        {
+            end_ += count;
+        }
+        else if (count == 0 || errno != EINTR)
+        {
+            eof_ = true;
+        }
+    }
+
+    return static_cast<std::size_t>(end_ - position_) >= n;
+}
+
+inline void Command_reader::fill_number()
+{
+    std::size_t length = 0;
+
+    while (true)
+    {
+        while (position_ + length != end_ && length < max_number_length_ &&
+               (std::isdigit(static_cast<unsigned char>(position_[length])) ||
+                (length == 0 && (*position_ == '+' || *position_ == '-'))))
+        {
+            ++length;
+        }
+
+        // the number ends by another character, by its maximal length or by the end of the input
+        if (position_ + length != end_ || length == max_number_length_ || !fill(length + 1))
+        {
+            return;
+        }
+    }
+}
+
+inline bool Command_reader::get(char & symbol)
+{
+    if (position_ == end_ && !fill(1))
+    {
+        fail_ = true;
+        return false;
+    }
+
+    symbol = *position_++;
+    return true;
+}
+
+inline bool Command_reader::read_int(int & value)
+{
+    if (fail_)
+    {
+        return false;
+    }
+
+    // skip spaces like operator>>
+    while (true)
+    {
+        if (position_ == end_ && !fill(1))
+        {
+            fail_ = true;
+            return false;
+        }
+        if (!std::isspace(static_cast<unsigned char>(*position_)))
+        {
+            break;
+        }
+        ++position_;
+    }
+
+    fill_number();
+
+    const char * first = position_;
+
+    if (*first == '+' && first + 1 != end_ && std::isdigit(static_cast<unsigned char>(first[1])))
+    {
+        ++first;
+    }
+
+    std::from_chars_result result = std::from_chars(first, const_cast<const char *>(end_), value);
+
+    if (result.ec != std::errc())
+    {
+        fail_ = true;
+        return false;
+    }
+
+    position_ = const_cast<char *>(result.ptr);
+    return true;
+}
+
+inline int Command_reader::read_digits()
+{
+    char digits[max_number_length_];
+    std::size_t length = 0;
+
+    if (std::isdigit(static_cast<unsigned char>(space_)))
+    {
+        digits[length++] = space_;
+    }
+
+    while (get(space_) && std::isdigit(static_cast<unsigned char>(space_)))
+    {
+        if (length < max_number_length_)
+        {
+            digits[length++] = space_;
+        }
+    }
+
+    int value = 0;
+    std::from_chars(digits, digits + length, value);
+
+    return value;
+}
+
+inline bool Command_reader::step(Command & command)
+{
+    if (space_ == '\n')
+    {
+        finished_ = true;
+        return false;
+    }
+    else if (space_ == ' ')
+    {
+        get(alpha_);
+    }
+    else if (std::isalpha(static_cast<unsigned char>(space_)))
+    {
+        // space is forgotten
+        ++command.missed_spaces_;
+        alpha_ = space_;
+    }
+
+    fail_ = false;
+    get(space_);
+
+    command.letter_ = alpha_;
+
+    if (space_ == '\n')
+    {
+        finished_ = true;
+        return false;
+    }
+    // enter a number
+    else if (space_ == ' ' && read_int(command.value_))
+    {
+        get(space_);
+        return true;
+    }
+    else if (fail_)
+    {
+        fail_ = false;
+        finished_ = true;
+        return false;
+    }
+    else if (space_ == '-')
+    {
+        // space is forgotten
+        ++command.missed_spaces_;
+        command.value_ = -1 * read_digits();
+        return true;
+    }
+    else if (std::isdigit(static_cast<unsigned char>(space_)))
+    {
+        // space is forgotten
+        ++command.missed_spaces_;
+        command.value_ = read_digits();
+        return true;
+    }
+    else
+    {
+        bad_input_ = true;
+        finished_ = true;
+        return false;
+    }
+}
+
+inline bool Command_reader::next(Command & command)
+{
+    command.missed_spaces_ = 0;
+
+    while (!finished_)
+    {
+        bool has_command = step(command);
+
+        if (alpha_ == '\n' || space_ == '\n')
+        {
+            finished_ = true;
+        }
+        if (has_command)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline bool Command_reader::bad_input() const
+{
+    return bad_input_;
+}
+
+inline bool Command_reader::buffered() const
+{
+    return position_ != end_;
+}
+
+inline bool Command_reader::wait(int timeout)
+{
+    if (buffered() || eof_)
+    {
+        return true;
+    }
+
+    pollfd input = {fd_, POLLIN, 0};
+    int count = ::poll(&input, 1, timeout);
+
+    // an error is found by the next read
+    return count != 0 && !(count < 0 && errno == EINTR);
+}
+
+#endif
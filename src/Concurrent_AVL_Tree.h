@@ -0,0 +1,553 @@
+#ifndef CONCURRENT_AVL_TREE_H_
+#define CONCURRENT_AVL_TREE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Node of a Concurrent_AVL_tree, it is never changed after it was published
+template<typename T>
+struct Shared_node
+{
+    T value_;
+    int height_;
+    int elements_; // quantity of elements in this subtree
+    const Shared_node<T> * left_branch_;
+    const Shared_node<T> * right_branch_;
+    Shared_node(const T & value, const Shared_node<T> * left_branch, const Shared_node<T> * right_branch)
+        : value_(value), left_branch_(left_branch), right_branch_(right_branch)
+    {
+        int left_height = left_branch == nullptr ? 0 : left_branch->height_;
+        int right_height = right_branch == nullptr ? 0 : right_branch->height_;
+
+        height_ = (left_height >= right_height ? left_height : right_height) + 1;
+        elements_ = (left_branch == nullptr ? 0 : left_branch->elements_) +
+                    (right_branch == nullptr ? 0 : right_branch->elements_) + 1;
+    }
+};
+
+// Numbers of reader threads, every thread keeps its number while it lives.
+// A thread which came when all numbers were taken tries again at its next read.
+class Reader_registry
+{
+    private:
+        struct Reader_number
+        {
+            int number_; // -1 if there was no free number
+            Reader_number();
+            ~Reader_number();
+            void acquire();
+        };
+        static std::mutex & mutex();
+        static std::vector<int> & free_numbers();
+        static int & next_number();
+    public:
+        static const int max_readers_ = 1024;
+        static int number(); // number of the calling thread, -1 if all numbers are taken
+};
+
+inline std::mutex & Reader_registry::mutex()
+{
+    static std::mutex registry_mutex;
+    return registry_mutex;
+}
+
+inline std::vector<int> & Reader_registry::free_numbers()
+{
+    static std::vector<int> numbers;
+    return numbers;
+}
+
+inline int & Reader_registry::next_number()
+{
+    static int number = 0;
+    return number;
+}
+
+inline Reader_registry::Reader_number::Reader_number() : number_(-1)
+{
+    acquire();
+}
+
+inline Reader_registry::Reader_number::~Reader_number()
+{
+    if (number_ != -1)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        free_numbers().push_back(number_);
+    }
+}
+
+inline void Reader_registry::Reader_number::acquire()
+{
+    std::lock_guard<std::mutex> lock(mutex());
+
+    if (!free_numbers().empty())
+    {
+        number_ = free_numbers().back();
+        free_numbers().pop_back();
+    }
+    else if (next_number() < max_readers_)
+    {
+        number_ = next_number()++;
+    }
+}
+
+inline int Reader_registry::number()
+{
+    thread_local Reader_number reader;
+
+    if (reader.number_ == -1)
+    {
+        reader.acquire();
+    }
+
+    return reader.number_;
+}
+
+// AVL tree for many reader threads and one writer thread.
+// The writer copies the path to a changed node and publishes a new root, so readers never wait
+// and always see a consistent version. Old nodes are freed when no reader can see them any more:
+// every reader marks the epoch in which it started, nodes retired in an epoch are freed
+// when all active readers started in later epochs. A reader beyond max_readers_ has no slot
+// for its epoch, it reads under the lock of the writer, so it is slower but nothing is freed under it.
+template<typename T>
+class Concurrent_AVL_tree
+{
+    private:
+        struct alignas(64) Reader_slot
+        {
+            std::atomic<std::uint64_t> epoch_; // 0 if the reader does not read now
+        };
+        struct Retired
+        {
+            std::uint64_t epoch_;
+            std::vector<const Shared_node<T> *> nodes_;
+        };
+        class Read_guard
+        {
+            private:
+                Reader_slot * slot_; // nullptr if the reader has no number
+                std::unique_lock<std::mutex> lock_; // of the writer for a reader without a number
+            public:
+                Read_guard(const Concurrent_AVL_tree<T> & tree);
+                ~Read_guard();
+        };
+        std::atomic<const Shared_node<T> *> root;
+        std::atomic<std::uint64_t> epoch_;
+        Reader_slot * slots_;
+        mutable std::mutex writer_mutex_;
+        std::vector<const Shared_node<T> *> retired_now_; // nodes of the current change
+        std::deque<Retired> retired_;
+        static int height(const Shared_node<T> * node);
+        static int elements_quantity(const Shared_node<T> * node);
+        const Shared_node<T> * make(const T & value, const Shared_node<T> * left_branch, const Shared_node<T> * right_branch);
+        void retire(const Shared_node<T> * node);
+        const Shared_node<T> * balance(const Shared_node<T> * left_branch, const T & value, const Shared_node<T> * right_branch);
+        const Shared_node<T> * insert(const Shared_node<T> * node, const T & item, bool & inserted);
+        const Shared_node<T> * remove(const Shared_node<T> * node, const T & item, bool & removed);
+        const Shared_node<T> * remove_min(const Shared_node<T> * node, const Shared_node<T> * & min_node);
+        void publish(const Shared_node<T> * new_root);
+        void collect(); // free nodes which readers can not see
+        void delete_all(const Shared_node<T> * node);
+    public:
+        Concurrent_AVL_tree();
+        Concurrent_AVL_tree(const Concurrent_AVL_tree<T> & tree) = delete;
+        Concurrent_AVL_tree<T> & operator=(const Concurrent_AVL_tree<T> & tree) = delete;
+        ~Concurrent_AVL_tree();
+        // for the writer
+        bool insert(const T & item);
+        bool remove(const T & item);
+        // for readers, they can be called at the same time with insert and remove
+        bool is_there(const T & item) const;
+        int size() const;
+        T k_th_order_statistic(int i) const;
+        int elem_less_than(const T & item) const;
+};
+
+template<typename T>
+Concurrent_AVL_tree<T>::Read_guard::Read_guard(const Concurrent_AVL_tree<T> & tree) : slot_(nullptr)
+{
+    int number = Reader_registry::number();
+
+    if (number == -1)
+    {
+        lock_ = std::unique_lock<std::mutex>(tree.writer_mutex_);
+        return;
+    }
+
+    // the writer must see the epoch before the reader loads the root
+    slot_ = &tree.slots_[number];
+    slot_->epoch_.store(tree.epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+template<typename T>
+Concurrent_AVL_tree<T>::Read_guard::~Read_guard()
+{
+    if (slot_ != nullptr)
+    {
+        slot_->epoch_.store(0, std::memory_order_release);
+    }
+}
+
+template<typename T>
+Concurrent_AVL_tree<T>::Concurrent_AVL_tree() : root(nullptr),
+                                                epoch_(1),
+                                                slots_(new Reader_slot[Reader_registry::max_readers_])
+{
+    for (int i = 0; i < Reader_registry::max_readers_; ++i)
+        slots_[i].epoch_.store(0, std::memory_order_relaxed);
+}
+
+template<typename T>
+Concurrent_AVL_tree<T>::~Concurrent_AVL_tree()
+{
+    // there are no readers any more
+    delete_all(root.load(std::memory_order_acquire));
+
+    for (const Shared_node<T> * node : retired_now_)
+        delete node;
+    for (Retired & retired : retired_)
+        for (const Shared_node<T> * node : retired.nodes_)
+            delete node;
+
+    delete[] slots_;
+}
+
+template<typename T>
+void Concurrent_AVL_tree<T>::delete_all(const Shared_node<T> * node)
+{
+    // nodes of the last version belong only to it, so they can be changed now
+    Shared_node<T> * current_node = const_cast<Shared_node<T> *>(node);
+
+    while (current_node != nullptr)
+    {
+        if (current_node->left_branch_ != nullptr)
+        {
+            Shared_node<T> * l_branch = const_cast<Shared_node<T> *>(current_node->left_branch_);
+            current_node->left_branch_ = l_branch->right_branch_;
+            l_branch->right_branch_ = current_node;
+            current_node = l_branch;
+        }
+        else
+        {
+            Shared_node<T> * r_branch = const_cast<Shared_node<T> *>(current_node->right_branch_);
+            delete current_node;
+            current_node = r_branch;
+        }
+    }
+}
+
+template<typename T>
+int Concurrent_AVL_tree<T>::height(const Shared_node<T> * node)
+{
+    return node == nullptr ? 0 : node->height_;
+}
+
+template<typename T>
+int Concurrent_AVL_tree<T>::elements_quantity(const Shared_node<T> * node)
+{
+    return node == nullptr ? 0 : node->elements_;
+}
+
+template<typename T>
+const Shared_node<T> * Concurrent_AVL_tree<T>::make(const T & value, const Shared_node<T> * left_branch, const Shared_node<T> * right_branch)
+{
+    return new Shared_node<T>(value, left_branch, right_branch);
+}
+
+template<typename T>
+void Concurrent_AVL_tree<T>::retire(const Shared_node<T> * node)
+{
+    retired_now_.push_back(node);
+}
+
+template<typename T>
+const Shared_node<T> * Concurrent_AVL_tree<T>::balance(const Shared_node<T> * left_branch, const T & value, const Shared_node<T> * right_branch)
+{
+    // the same rotations as in AVL_tree, but rotated nodes are copied
+    if (height(left_branch) > height(right_branch) + 1)
+    {
+        if (height(left_branch->left_branch_) >= height(left_branch->right_branch_))
+        {
+            // R_rotate
+            retire(left_branch);
+            return make(left_branch->value_, left_branch->left_branch_,
+                        make(value, left_branch->right_branch_, right_branch));
+        }
+
+        // LR_rotate
+        const Shared_node<T> * middle = left_branch->right_branch_;
+        retire(left_branch);
+        retire(middle);
+        return make(middle->value_, make(left_branch->value_, left_branch->left_branch_, middle->left_branch_),
+                                    make(value, middle->right_branch_, right_branch));
+    }
+    if (height(right_branch) > height(left_branch) + 1)
+    {
+        if (height(right_branch->right_branch_) >= height(right_branch->left_branch_))
+        {
+            // L_rotate
+            retire(right_branch);
+            return make(right_branch->value_, make(value, left_branch, right_branch->left_branch_),
+                        right_branch->right_branch_);
+        }
+
+        // RL_rotate
+        const Shared_node<T> * middle = right_branch->left_branch_;
+        retire(right_branch);
+        retire(middle);
+        return make(middle->value_, make(value, left_branch, middle->left_branch_),
+                                    make(right_branch->value_, middle->right_branch_, right_branch->right_branch_));
+    }
+
+    return make(value, left_branch, right_branch);
+}
+
+template<typename T>
+const Shared_node<T> * Concurrent_AVL_tree<T>::insert(const Shared_node<T> * node, const T & item, bool & inserted)
+{
+    if (node == nullptr)
+    {
+        inserted = true;
+        return make(item, nullptr, nullptr);
+    }
+
+    if (item < node->value_)
+    {
+        const Shared_node<T> * l_branch = insert(node->left_branch_, item, inserted);
+        if (!inserted) return node;
+
+        retire(node);
+        return balance(l_branch, node->value_, node->right_branch_);
+    }
+    if (node->value_ < item)
+    {
+        const Shared_node<T> * r_branch = insert(node->right_branch_, item, inserted);
+        if (!inserted) return node;
+
+        retire(node);
+        return balance(node->left_branch_, node->value_, r_branch);
+    }
+
+    // the item is already in the tree
+    inserted = false;
+    return node;
+}
+
+template<typename T>
+const Shared_node<T> * Concurrent_AVL_tree<T>::remove_min(const Shared_node<T> * node, const Shared_node<T> * & min_node)
+{
+    retire(node);
+
+    if (node->left_branch_ == nullptr)
+    {
+        min_node = node;
+        return node->right_branch_;
+    }
+
+    const Shared_node<T> * l_branch = remove_min(node->left_branch_, min_node);
+    return balance(l_branch, node->value_, node->right_branch_);
+}
+
+template<typename T>
+const Shared_node<T> * Concurrent_AVL_tree<T>::remove(const Shared_node<T> * node, const T & item, bool & removed)
+{
+    if (node == nullptr)
+    {
+        removed = false;
+        return nullptr;
+    }
+
+    if (item < node->value_)
+    {
+        const Shared_node<T> * l_branch = remove(node->left_branch_, item, removed);
+        if (!removed) return node;
+
+        retire(node);
+        return balance(l_branch, node->value_, node->right_branch_);
+    }
+    if (node->value_ < item)
+    {
+        const Shared_node<T> * r_branch = remove(node->right_branch_, item, removed);
+        if (!removed) return node;
+
+        retire(node);
+        return balance(node->left_branch_, node->value_, r_branch);
+    }
+
+    // node for delete was found
+    removed = true;
+    retire(node);
+
+    if (node->left_branch_ == nullptr) return node->right_branch_;
+    if (node->right_branch_ == nullptr) return node->left_branch_;
+
+    // the smallest element of the right branch takes the place of the node
+    const Shared_node<T> * min_node = nullptr;
+    const Shared_node<T> * r_branch = remove_min(node->right_branch_, min_node);
+
+    return balance(node->left_branch_, min_node->value_, r_branch);
+}
+
+template<typename T>
+void Concurrent_AVL_tree<T>::publish(const Shared_node<T> * new_root)
+{
+    root.store(new_root, std::memory_order_seq_cst);
+
+    // readers which start after the new epoch can not see retired nodes
+    std::uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+
+    retired_.push_back(Retired{epoch, std::move(retired_now_)});
+    retired_now_.clear();
+
+    collect();
+}
+
+template<typename T>
+void Concurrent_AVL_tree<T>::collect()
+{
+    std::uint64_t min_epoch = UINT64_MAX;
+
+    for (int i = 0; i < Reader_registry::max_readers_; ++i)
+    {
+        std::uint64_t epoch = slots_[i].epoch_.load(std::memory_order_seq_cst);
+
+        if (epoch != 0 && epoch < min_epoch)
+        {
+            min_epoch = epoch;
+        }
+    }
+
+    while (!retired_.empty() && retired_.front().epoch_ < min_epoch)
+    {
+        for (const Shared_node<T> * node : retired_.front().nodes_)
+            delete node;
+
+        retired_.pop_front();
+    }
+}
+
+template<typename T>
+bool Concurrent_AVL_tree<T>::insert(const T & item)
+{
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+
+    bool inserted = false;
+    const Shared_node<T> * new_root = insert(root.load(std::memory_order_relaxed), item, inserted);
+
+    if (inserted)
+    {
+        publish(new_root);
+    }
+
+    return inserted;
+}
+
+template<typename T>
+bool Concurrent_AVL_tree<T>::remove(const T & item)
+{
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+
+    bool removed = false;
+    const Shared_node<T> * new_root = remove(root.load(std::memory_order_relaxed), item, removed);
+
+    if (removed)
+    {
+        publish(new_root);
+    }
+
+    return removed;
+}
+
+template<typename T>
+bool Concurrent_AVL_tree<T>::is_there(const T & item) const
+{
+    Read_guard guard(*this);
+    const Shared_node<T> * current_node = root.load(std::memory_order_seq_cst);
+
+    while (current_node != nullptr)
+    {
+        if (item < current_node->value_)
+        {
+            current_node = current_node->left_branch_;
+        }
+        else if (current_node->value_ < item)
+        {
+            current_node = current_node->right_branch_;
+        }
+        else
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T>
+int Concurrent_AVL_tree<T>::size() const
+{
+    Read_guard guard(*this);
+    return elements_quantity(root.load(std::memory_order_seq_cst));
+}
+
+template<typename T>
+T Concurrent_AVL_tree<T>::k_th_order_statistic(int i) const
+{
+    Read_guard guard(*this);
+    const Shared_node<T> * current_node = root.load(std::memory_order_seq_cst);
+
+    if (i <= 0 || i > elements_quantity(current_node))
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return T();
+    }
+
+    while (true)
+    {
+        int left_elements = elements_quantity(current_node->left_branch_);
+
+        if (i <= left_elements)
+        {
+            current_node = current_node->left_branch_;
+        }
+        else if (i == left_elements + 1)
+        {
+            return current_node->value_;
+        }
+        else
+        {
+            i -= left_elements + 1;
+            current_node = current_node->right_branch_;
+        }
+    }
+}
+
+template<typename T>
+int Concurrent_AVL_tree<T>::elem_less_than(const T & item) const
+{
+    Read_guard guard(*this);
+    const Shared_node<T> * current_node = root.load(std::memory_order_seq_cst);
+    int count = 0;
+
+    while (current_node != nullptr)
+    {
+        if (current_node->value_ < item)
+        {
+            count += elements_quantity(current_node->left_branch_) + 1;
+            current_node = current_node->right_branch_;
+        }
+        else
+        {
+            current_node = current_node->left_branch_;
+        }
+    }
+
+    return count;
+}
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef FROZEN_AVL_TREE_H_
+#define FROZEN_AVL_TREE_H_
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Read-only snapshot of an AVL_tree. Keys are stored in one array in Eytzinger (BFS) order:
+// children of keys_[k] are keys_[2k] and keys_[2k + 1], keys_[0] is unused.
+// So a search goes through the array from the beginning and the next levels can be prefetched.
+template<typename T, typename Compare = std::less<T>>
+class Frozen_AVL_tree
+{
+    private:
+        // keys in one cache line, a search prefetches the line of descendants 4 levels below
+        static const int prefetch_step_ = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+        std::vector<T> keys_;
+        std::vector<int> ranks_; // ranks_[k] is quantity of keys which are less than keys_[k]
+        int size_;
+        [[no_unique_address]] Compare comp_;
+        int first() const; // index of the min key
+        int next(int k) const;
+        int previous(int k) const;
+        template<typename K>
+        int lower_bound(const K & item) const; // index of the first key which is not less than item, 0 if there is not
+    public:
+        explicit Frozen_AVL_tree(const Compare & comp = Compare());
+        template<typename InputIt>
+        Frozen_AVL_tree(InputIt first, int count, const Compare & comp = Compare()); // count sorted keys without duplicates
+        bool is_there(const T & item) const;
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        bool is_there(const K & item) const;
+        int size() const;
+        T k_th_order_statistic(int i) const;
+        int elem_less_than(const T & item) const;
+        template<typename K, typename C = Compare, typename = typename C::is_transparent>
+        int elem_less_than(const K & item) const;
+
+        class iterator
+        {
+            friend class Frozen_AVL_tree;
+            private:
+                const Frozen_AVL_tree<T, Compare> * tree_;
+                int index_; // 0 is the end of the container
+                iterator(const Frozen_AVL_tree<T, Compare> * tree, int index) : tree_(tree), index_(index) {}
+            public:
+                using iterator_category = std::bidirectional_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const T *;
+                using reference = const T &;
+                iterator() : tree_(nullptr), index_(0) {}
+                const T & operator*() const
+                {
+                    return tree_->keys_[index_];
+                }
+                bool operator==(const iterator & it) const
+                {
+                    return tree_ == it.tree_ && index_ == it.index_;
+                }
+                bool operator!=(const iterator & it) const
+                {
+                    return !(*this == it);
+                }
+                iterator & operator++()
+                {
+                    index_ = tree_->next(index_);
+                    return *this;
+                }
+                iterator operator++(int)
+                {
+                    iterator it = *this;
+                    ++(*this);
+                    return it;
+                }
+                iterator & operator--()
+                {
+                    // the end goes to the max key
+                    index_ = tree_->previous(index_);
+                    return *this;
+                }
+                iterator operator--(int)
+                {
+                    iterator it = *this;
+                    --(*this);
+                    return it;
+                }
+        };
+        iterator begin() const
+        {
+            return iterator(this, first());
+        }
+        iterator end() const
+        {
+            return iterator(this, 0);
+        }
+};
+
+template<typename T, typename Compare>
+Frozen_AVL_tree<T, Compare>::Frozen_AVL_tree(const Compare & comp) : keys_(1), ranks_(1), size_(0), comp_(comp) {}
+
+template<typename T, typename Compare>
+template<typename InputIt>
+Frozen_AVL_tree<T, Compare>::Frozen_AVL_tree(InputIt first, int count, const Compare & comp) : keys_(count + 1),
+                                                                                                  ranks_(count + 1),
+                                                                                                  size_(count),
+                                                                                                  comp_(comp)
+{
+    // in-order walk of the implicit tree takes keys in sorted order
+    int k = this->first();
+
+    for (int i = 0; i < count; ++i, ++first)
+    {
+        keys_[k] = *first;
+        ranks_[k] = i;
+        k = next(k);
+    }
+}
+
+template<typename T, typename Compare>
+int Frozen_AVL_tree<T, Compare>::first() const
+{
+    if (size_ == 0)
+    {
+        return 0;
+    }
+
+    int k = 1;
+
+    while (2 * k <= size_)
+        k = 2 * k;
+
+    return k;
+}
+
+template<typename T, typename Compare>
+int Frozen_AVL_tree<T, Compare>::next(int k) const
+{
+    if (2 * k + 1 <= size_)
+    {
+        // min key of the right branch
+        k = 2 * k + 1;
+
+        while (2 * k <= size_)
+            k = 2 * k;
+
+        return k;
+    }
+
+    // go up while k is a right child, then one more step
+    while (k & 1)
+        k >>= 1;
+
+    return k >> 1;
+}
+
+template<typename T, typename Compare>
+int Frozen_AVL_tree<T, Compare>::previous(int k) const
+{
+    if (k == 0)
+    {
+        k = 1;
+
+        while (2 * k + 1 <= size_)
+            k = 2 * k + 1;
+
+        return size_ == 0 ? 0 : k;
+    }
+
+    if (2 * k <= size_)
+    {
+        // max key of the left branch
+        k = 2 * k;
+
+        while (2 * k + 1 <= size_)
+            k = 2 * k + 1;
+
+        return k;
+    }
+
+    // go up while k is a left child, then one more step
+    while (k > 1 && !(k & 1))
+        k >>= 1;
+
+    return k >> 1;
+}
+
+template<typename T, typename Compare>
+template<typename K>
+int Frozen_AVL_tree<T, Compare>::lower_bound(const K & item) const
+{
+    int k = 1;
+
+    while (k <= size_)
+    {
+        __builtin_prefetch(keys_.data() + static_cast<long>(prefetch_step_) * k);
+        k = 2 * k + comp_(keys_[k], item);
+    }
+
+    // remove the right turns after the last left turn
+    k >>= __builtin_ffs(~k);
+
+    return k;
+}
+
+template<typename T, typename Compare>
+bool Frozen_AVL_tree<T, Compare>::is_there(const T & item) const
+{
+    int k = lower_bound(item);
+
+    return k != 0 && !comp_(item, keys_[k]);
+}
+
+template<typename T, typename Compare>
+template<typename K, typename C, typename>
+bool Frozen_AVL_tree<T, Compare>::is_there(const K & item) const
+{
+    int k = lower_bound(item);
+
+    return k != 0 && !comp_(item, keys_[k]);
+}
+
+template<typename T, typename Compare>
+int Frozen_AVL_tree<T, Compare>::size() const
+{
+    return size_;
+}
+
+template<typename T, typename Compare>
+T Frozen_AVL_tree<T, Compare>::k_th_order_statistic(int i) const
+{
+    if (i <= 0 || i > size_)
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return T();
+    }
+
+    // search by ranks like by keys
+    int k = 1;
+
+    while (ranks_[k] != i - 1)
+    {
+        k = 2 * k + (ranks_[k] < i - 1);
+    }
+
+    return keys_[k];
+}
+
+template<typename T, typename Compare>
+int Frozen_AVL_tree<T, Compare>::elem_less_than(const T & item) const
+{
+    int k = lower_bound(item);
+
+    return k == 0 ? size_ : ranks_[k];
+}
+
+template<typename T, typename Compare>
+template<typename K, typename C, typename>
+int Frozen_AVL_tree<T, Compare>::elem_less_than(const K & item) const
+{
+    int k = lower_bound(item);
+
+    return k == 0 ? size_ : ranks_[k];
+}
+
+#endif
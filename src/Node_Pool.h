@@ -0,0 +1,252 @@
+#ifndef NODE_POOL_H_
+#define NODE_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Arena for objects of one size. Objects are cut from big contiguous blocks,
+// freed objects go to a free list and are reused, all blocks are freed at once.
+// It is not thread-safe.
+class Pool_arena
+{
+    private:
+        struct Free_object
+        {
+            Free_object * next_;
+        };
+        static const std::size_t first_block_objects_ = 256;
+        static const std::size_t max_block_objects_ = 65536;
+        std::vector<void *> blocks_;
+        Free_object * free_list_;
+        char * current_; // first unused byte of the last block
+        char * end_;     // end of the last block
+        std::size_t object_size_;
+        std::size_t alignment_;
+        std::size_t block_objects_; // quantity of objects in the next block
+        void add_block();
+    public:
+        Pool_arena(std::size_t object_size, std::size_t alignment);
+        Pool_arena(const Pool_arena & arena) = delete;
+        Pool_arena & operator=(const Pool_arena & arena) = delete;
+        ~Pool_arena();
+        void * allocate();
+        void deallocate(void * object);
+        void release(); // free all blocks, it takes O(blocks)
+};
+
+inline Pool_arena::Pool_arena(std::size_t object_size, std::size_t alignment)
+{
+    if (alignment < alignof(Free_object))
+    {
+        alignment = alignof(Free_object);
+    }
+    if (object_size < sizeof(Free_object))
+    {
+        object_size = sizeof(Free_object);
+    }
+
+    // every object in a block has to be aligned
+    object_size_ = (object_size + alignment - 1) / alignment * alignment;
+    alignment_ = alignment;
+    block_objects_ = first_block_objects_;
+    free_list_ = nullptr;
+    current_ = nullptr;
+    end_ = nullptr;
+}
+
+inline Pool_arena::~Pool_arena()
+{
+    release();
+}
+
+inline void Pool_arena::add_block()
+{
+    std::size_t block_size = object_size_ * block_objects_;
+    void * block = ::operator new(block_size, std::align_val_t(alignment_));
+
+    try
+    {
+        blocks_.push_back(block);
+    }
+    catch (...)
+    {
+        ::operator delete(block, std::align_val_t(alignment_));
+        throw;
+    }
+
+    current_ = static_cast<char *>(block);
+    end_ = current_ + block_size;
+
+    // next blocks are bigger, so a big tree needs only a few of them
+    if (block_objects_ < max_block_objects_)
+    {
+        block_objects_ *= 2;
+    }
+}
+
+inline void * Pool_arena::allocate()
+{
+    if (free_list_ != nullptr)
+    {
+        Free_object * object = free_list_;
+        free_list_ = free_list_->next_;
+
+        return object;
+    }
+
+    if (current_ == end_)
+    {
+        add_block();
+    }
+
+    void * object = current_;
+    current_ += object_size_;
+
+    return object;
+}
+
+inline void Pool_arena::deallocate(void * object)
+{
+    Free_object * free_object = static_cast<Free_object *>(object);
+    free_object->next_ = free_list_;
+    free_list_ = free_object;
+}
+
+inline void Pool_arena::release()
+{
+    for (void * block : blocks_)
+    {
+        ::operator delete(block, std::align_val_t(alignment_));
+    }
+
+    blocks_.clear();
+    block_objects_ = first_block_objects_;
+    free_list_ = nullptr;
+    current_ = nullptr;
+    end_ = nullptr;
+}
+
+// Arenas of one pool, an arena for every size and alignment of objects.
+class Pool_arenas
+{
+    private:
+        struct Entry
+        {
+            std::size_t object_size_;
+            std::size_t alignment_;
+            std::unique_ptr<Pool_arena> arena_;
+        };
+        std::vector<Entry> arenas_;
+    public:
+        Pool_arena * arena(std::size_t object_size, std::size_t alignment); // it is made by the first request
+        void release(); // free all blocks of all arenas
+};
+
+inline Pool_arena * Pool_arenas::arena(std::size_t object_size, std::size_t alignment)
+{
+    for (Entry & entry : arenas_)
+    {
+        if (entry.object_size_ == object_size && entry.alignment_ == alignment)
+        {
+            return entry.arena_.get();
+        }
+    }
+
+    arenas_.push_back(Entry{object_size, alignment, std::make_unique<Pool_arena>(object_size, alignment)});
+
+    return arenas_.back().arena_.get();
+}
+
+inline void Pool_arenas::release()
+{
+    for (Entry & entry : arenas_)
+    {
+        entry.arena_->release();
+    }
+}
+
+// std::allocator-compatible allocator which takes single objects from a Pool_arena.
+// Copies share the arenas, also copies for other types, so a rebound pool is equal
+// to the original one and frees its objects. A copy made for a new container gets its own arenas.
+template<typename T>
+class Node_pool
+{
+    template<typename U>
+    friend class Node_pool;
+    private:
+        std::shared_ptr<Pool_arenas> arenas_;
+        Pool_arena * arena_; // the arena of objects of T
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::false_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::false_type;
+
+        Node_pool() : arenas_(std::make_shared<Pool_arenas>()),
+                      arena_(arenas_->arena(sizeof(T), alignof(T))) {}
+        Node_pool(const Node_pool<T> & pool) = default;
+        // the arena is bound to the size of objects, so a rebound pool takes another arena of the same pool
+        template<typename U>
+        Node_pool(const Node_pool<U> & pool) : arenas_(pool.arenas_),
+                                               arena_(arenas_->arena(sizeof(T), alignof(T))) {}
+        Node_pool<T> & operator=(const Node_pool<T> & pool) = default;
+
+        T * allocate(std::size_t n)
+        {
+            if (n == 1)
+            {
+                return static_cast<T *>(arena_->allocate());
+            }
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        void deallocate(T * p, std::size_t n)
+        {
+            if (n == 1)
+            {
+                arena_->deallocate(p);
+            }
+            else
+            {
+                ::operator delete(p, std::align_val_t(alignof(T)));
+            }
+        }
+        // free all objects of all types at once if nobody else uses these arenas,
+        // objects are not destroyed
+        bool release()
+        {
+            if (arenas_.use_count() != 1)
+            {
+                return false;
+            }
+
+            arenas_->release();
+            return true;
+        }
+        Node_pool<T> select_on_container_copy_construction() const
+        {
+            return Node_pool<T>();
+        }
+
+        template<typename U>
+        bool operator==(const Node_pool<U> & pool) const
+        {
+            return arenas_ == pool.arenas_;
+        }
+        template<typename U>
+        bool operator!=(const Node_pool<U> & pool) const
+        {
+            return arenas_ != pool.arenas_;
+        }
+};
+
+template<typename A>
+struct is_node_pool : std::false_type {};
+
+template<typename T>
+struct is_node_pool<Node_pool<T>> : std::true_type {};
+
+#endif
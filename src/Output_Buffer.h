@@ -0,0 +1,125 @@
+#ifndef OUTPUT_BUFFER_H_
+#define OUTPUT_BUFFER_H_
+
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <streambuf>
+#include <type_traits>
+#include <unistd.h>
+
+// Writes results of queries to a file descriptor by big blocks.
+// Numbers are formatted by std::to_chars right into the buffer. It is a streambuf too,
+// so a stream which uses it can be tied to std::cerr and will be flushed before any message.
+class Output_buffer : public std::streambuf
+{
+    private:
+        static const std::size_t buffer_size_ = 1 << 20;
+        static const std::size_t max_number_length_ = 64;
+        int fd_;
+        std::unique_ptr<char[]> buffer_;
+        char separator_; // symbol after every result
+        bool write_all(const char * data, std::size_t size);
+    protected:
+        int_type overflow(int_type symbol) override;
+        int sync() override;
+    public:
+        explicit Output_buffer(int fd, char separator = ' ');
+        Output_buffer(const Output_buffer & output) = delete;
+        Output_buffer & operator=(const Output_buffer & output) = delete;
+        ~Output_buffer() override;
+        template<typename T>
+        void write(T value);
+        void finish(); // end of the output like std::endl
+        bool flush();
+};
+
+inline Output_buffer::Output_buffer(int fd, char separator) : fd_(fd),
+                                                              buffer_(new char[buffer_size_]),
+                                                              separator_(separator)
+{
+    setp(buffer_.get(), buffer_.get() + buffer_size_);
+}
+
+inline Output_buffer::~Output_buffer()
+{
+    flush();
+}
+
+inline bool Output_buffer::write_all(const char * data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t count = ::write(fd_, data, size);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        data += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+inline bool Output_buffer::flush()
+{
+    bool success = write_all(pbase(), pptr() - pbase());
+    setp(buffer_.get(), buffer_.get() + buffer_size_);
+
+    return success;
+}
+
+inline Output_buffer::int_type Output_buffer::overflow(int_type symbol)
+{
+    if (!flush())
+    {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(symbol, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(symbol);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(symbol);
+}
+
+inline int Output_buffer::sync()
+{
+    return flush() ? 0 : -1;
+}
+
+template<typename T>
+void Output_buffer::write(T value)
+{
+    static_assert(std::is_integral<T>::value, "Output_buffer formats only integer results");
+
+    if (static_cast<std::size_t>(epptr() - pptr()) < max_number_length_ + 1)
+    {
+        flush();
+    }
+
+    std::to_chars_result result = std::to_chars(pptr(), epptr(), value);
+    *result.ptr = separator_;
+    pbump(static_cast<int>(result.ptr + 1 - pptr()));
+}
+
+inline void Output_buffer::finish()
+{
+    // results are separated by spaces in one line, so the line has to be closed
+    if (separator_ != '\n')
+    {
+        sputc('\n');
+    }
+    flush();
+}
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef SHARDED_AVL_TREE_H_
+#define SHARDED_AVL_TREE_H_
+
+#include "Command_Reader.h"
+#include "Spsc_Queue.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Keys are divided by ranges between shards, every shard is a Tree with its own worker thread
+// which takes tasks from its own SPSC queue. Commands go by batches in two phases:
+//   1. every shard checks which of its inserts add new keys, the main thread learns
+//      the size of every shard before every command of the batch;
+//   2. inserts go to their shards, 'n' is the sum of elem_less_than over the shards,
+//      so it is the sizes of the lower shards plus elem_less_than in the shard of the key,
+//      'm' is found by the sizes in one shard with its local rank.
+// A shard takes its tasks in the order of commands, so every answer is the same as
+// the answer of one tree which executes commands one after another.
+// Tree is an AVL_tree or an AVL_multiset of int, a multiset needs only the second phase.
+template<typename Tree>
+class Sharded_AVL_tree
+{
+    private:
+        enum Operation : char { check_, checked_, insert_, k_th_, less_, done_, stop_ };
+        struct Task
+        {
+            Operation operation_;
+            int value_;
+            int index_; // command of the batch
+        };
+        struct Shard
+        {
+            Tree tree_;
+            Spsc_queue<Task> queue_;
+            std::vector<std::pair<int, int>> new_keys_; // keys of the batch which are not in the tree and their commands
+            std::thread worker_;
+            Shard() : queue_(queue_size_) {}
+        };
+        static const int queue_size_ = 4096;
+        static constexpr bool copies_ = requires (const Tree & tree, int key) { tree.count(key); };
+        std::vector<std::unique_ptr<Shard>> shards_;
+        std::vector<int> bounds_;          // shard i keeps keys from bounds_[i - 1] to bounds_[i]
+        std::vector<int> sizes_;           // sizes of the shards after the started batches
+        int size_;
+        std::vector<unsigned char> fresh_; // 'k' of the batch inserts a new key
+        Command_result * results_;
+        std::atomic<int> pending_;         // shards which did not finish the current phase
+        void work(Shard & shard);
+        int shard_of(int key) const;
+        void choose_bounds(const Command * commands, int count);
+        void mark_fresh(Shard & shard); // the first insert of every new key adds it
+        void finish_phase();
+        void send(Operation operation);
+        void wait();
+    public:
+        explicit Sharded_AVL_tree(int shards);
+        Sharded_AVL_tree(const Sharded_AVL_tree & tree) = delete;
+        Sharded_AVL_tree & operator=(const Sharded_AVL_tree & tree) = delete;
+        ~Sharded_AVL_tree();
+        // starts a batch, the previous one has to be finished, results are ready after finish
+        void start(const Command * commands, int count, Command_result * results);
+        void finish();
+        int size() const; // after the started batches
+        int shards() const;
+};
+
+template<typename Tree>
+Sharded_AVL_tree<Tree>::Sharded_AVL_tree(int shards) : sizes_(shards > 0 ? shards : 1),
+                                                       size_(0),
+                                                       results_(nullptr),
+                                                       pending_(0)
+{
+    for (std::size_t i = 0; i < sizes_.size(); ++i)
+    {
+        shards_.emplace_back(new Shard());
+        shards_.back()->tree_.set_quiet(true);
+    }
+
+    for (std::unique_ptr<Shard> & shard : shards_)
+        shard->worker_ = std::thread(&Sharded_AVL_tree<Tree>::work, this, std::ref(*shard));
+}
+
+template<typename Tree>
+Sharded_AVL_tree<Tree>::~Sharded_AVL_tree()
+{
+    for (std::unique_ptr<Shard> & shard : shards_)
+        shard->queue_.push(Task{stop_, 0, 0});
+    for (std::unique_ptr<Shard> & shard : shards_)
+        shard->worker_.join();
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::work(Shard & shard)
+{
+    Task task;
+
+    while (true)
+    {
+        shard.queue_.pop(task);
+
+        switch (task.operation_)
+        {
+            case check_:
+                if (!shard.tree_.is_there(task.value_))
+                {
+                    shard.new_keys_.emplace_back(task.value_, task.index_);
+                }
+                break;
+            case checked_:
+                mark_fresh(shard);
+                finish_phase();
+                break;
+            case insert_:
+                shard.tree_.insert(task.value_);
+                break;
+            case k_th_:
+                results_[task.index_].value_ = shard.tree_.k_th_order_statistic(task.value_);
+                break;
+            case less_:
+                // the main thread has already written the sizes of the lower shards
+                results_[task.index_].value_ += shard.tree_.elem_less_than(task.value_);
+                break;
+            case done_:
+                finish_phase();
+                break;
+            case stop_:
+                return;
+        }
+    }
+}
+
+template<typename Tree>
+int Sharded_AVL_tree<Tree>::shard_of(int key) const
+{
+    return static_cast<int>(std::upper_bound(bounds_.begin(), bounds_.end(), key) - bounds_.begin());
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::choose_bounds(const Command * commands, int count)
+{
+    std::vector<int> keys;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (commands[i].letter_ == 'k')
+        {
+            keys.push_back(commands[i].value_);
+        }
+    }
+
+    if (keys.empty())
+    {
+        // all keys are in the first shard until there are keys to divide
+        return;
+    }
+
+    // the first keys are a sample of the stream, every shard gets an equal part of them
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    for (std::size_t i = 1; i < shards_.size(); ++i)
+        bounds_.push_back(keys[keys.size() * i / shards_.size()]);
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::mark_fresh(Shard & shard)
+{
+    // pairs are sorted by keys and then by commands, so the first pair of a key is its first insert
+    std::sort(shard.new_keys_.begin(), shard.new_keys_.end());
+
+    for (std::size_t i = 0; i < shard.new_keys_.size(); ++i)
+    {
+        if (i == 0 || shard.new_keys_[i].first != shard.new_keys_[i - 1].first)
+        {
+            fresh_[shard.new_keys_[i].second] = true;
+        }
+    }
+
+    shard.new_keys_.clear();
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::finish_phase()
+{
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        pending_.notify_one();
+    }
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::send(Operation operation)
+{
+    // every shard answers when it has done all tasks before this one
+    pending_.store(static_cast<int>(shards_.size()), std::memory_order_relaxed);
+
+    for (std::unique_ptr<Shard> & shard : shards_)
+        shard->queue_.push(Task{operation, 0, 0});
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::wait()
+{
+    int pending = pending_.load(std::memory_order_acquire);
+
+    while (pending != 0)
+    {
+        pending_.wait(pending, std::memory_order_acquire);
+        pending = pending_.load(std::memory_order_acquire);
+    }
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::start(const Command * commands, int count, Command_result * results)
+{
+    // bounds can be changed only while all shards are empty
+    if (bounds_.empty() && size_ == 0)
+    {
+        choose_bounds(commands, count);
+    }
+
+    results_ = results;
+    fresh_.assign(count, copies_);
+
+    if (!copies_)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (commands[i].letter_ == 'k')
+            {
+                shards_[shard_of(commands[i].value_)]->queue_.push(Task{check_, commands[i].value_, i});
+            }
+        }
+
+        send(checked_);
+        wait();
+    }
+
+    // sizes_ go through the batch with the commands
+    for (int i = 0; i < count; ++i)
+    {
+        int value = commands[i].value_;
+        results[i].value_ = 0;
+        results[i].done_ = false;
+
+        if (commands[i].letter_ == 'k' && fresh_[i])
+        {
+            int shard = shard_of(value);
+            ++sizes_[shard];
+            ++size_;
+            results[i].done_ = true;
+            shards_[shard]->queue_.push(Task{insert_, value, i});
+        }
+        else if (commands[i].letter_ == 'm' && value > 0 && value <= size_)
+        {
+            int shard = 0;
+
+            while (value > sizes_[shard])
+                value -= sizes_[shard++];
+
+            results[i].done_ = true;
+            shards_[shard]->queue_.push(Task{k_th_, value, i});
+        }
+        else if (commands[i].letter_ == 'n')
+        {
+            int shard = shard_of(value);
+
+            for (int j = 0; j < shard; ++j)
+                results[i].value_ += sizes_[j];
+
+            shards_[shard]->queue_.push(Task{less_, value, i});
+        }
+    }
+
+    send(done_);
+}
+
+template<typename Tree>
+void Sharded_AVL_tree<Tree>::finish()
+{
+    wait();
+}
+
+template<typename Tree>
+int Sharded_AVL_tree<Tree>::size() const
+{
+    return size_;
+}
+
+template<typename Tree>
+int Sharded_AVL_tree<Tree>::shards() const
+{
+    return static_cast<int>(shards_.size());
+}
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File of a snapshot: the header and then all keys in sorted order. A snapshot of AVL_tree
+// has no duplicates, a snapshot of AVL_multiset has every copy of a key one after another.
+// Keys are written as they are in memory, so a file can be read only on a machine
+// with the same byte order and the same size of keys.
+// log_epoch_ is the first epoch of Write_ahead_log records which are not in the snapshot,
+// so records which were saved but not cleared from the log before a crash are not replayed again.
+struct Snapshot_header
+{
+    char magic_[8];
+    std::uint32_t version_;
+    std::uint32_t byte_order_; // byte_order_mark written in the byte order of the machine
+    std::uint32_t key_size_;
+    std::uint32_t log_epoch_;
+    std::uint64_t count_;
+};
+
+const char snapshot_magic[8] = {'A', 'V', 'L', 'S', 'N', 'A', 'P', '\0'};
+const std::uint32_t snapshot_version = 1;
+const std::uint32_t byte_order_mark = 0x01020304;
+
+template<typename T>
+bool check_snapshot_header(const Snapshot_header & header, std::uint64_t file_size, const char * path)
+{
+    if (std::memcmp(header.magic_, snapshot_magic, sizeof(snapshot_magic)) != 0 ||
+        header.version_ != snapshot_version ||
+        header.byte_order_ != byte_order_mark ||
+        header.key_size_ != sizeof(T) ||
+        header.count_ > static_cast<std::uint64_t>(INT_MAX) ||
+        header.count_ > (file_size - sizeof(Snapshot_header)) / sizeof(T) ||
+        file_size != sizeof(Snapshot_header) + header.count_ * sizeof(T))
+    {
+        std::cerr << "Wrong snapshot file " << path << "." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+inline bool write_snapshot_data(int fd, const char * data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t count = ::write(fd, data, size);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        data += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+// count sorted keys are written to a temporary file which replaces the old snapshot,
+// so a crash during saving does not spoil the old one
+template<typename T, typename InputIt>
+bool save_snapshot(const char * path, InputIt first, std::uint64_t count, std::uint32_t log_epoch = 0)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable keys can be saved");
+
+    std::string temporary_path = std::string(path) + ".tmp";
+    int fd = ::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        std::cerr << "Can not write snapshot " << temporary_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    Snapshot_header header = {};
+    std::memcpy(header.magic_, snapshot_magic, sizeof(snapshot_magic));
+    header.version_ = snapshot_version;
+    header.byte_order_ = byte_order_mark;
+    header.key_size_ = sizeof(T);
+    header.log_epoch_ = log_epoch;
+    header.count_ = count;
+
+    // keys go to the file by big blocks
+    const std::size_t block_size = (1 << 20) / sizeof(T) + 1;
+    std::vector<T> block;
+    block.reserve(block_size);
+    bool success = write_snapshot_data(fd, reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (std::uint64_t i = 0; success && i < count; ++i, ++first)
+    {
+        block.push_back(*first);
+
+        if (block.size() == block_size || i + 1 == count)
+        {
+            success = write_snapshot_data(fd, reinterpret_cast<const char *>(block.data()), block.size() * sizeof(T));
+            block.clear();
+        }
+    }
+
+    success = success && ::fsync(fd) == 0;
+
+    if (!success)
+    {
+        std::cerr << "Can not write snapshot " << temporary_path << ": " << std::strerror(errno) << std::endl;
+    }
+
+    ::close(fd);
+
+    if (success && ::rename(temporary_path.c_str(), path) != 0)
+    {
+        std::cerr << "Can not write snapshot " << path << ": " << std::strerror(errno) << std::endl;
+        success = false;
+    }
+    if (!success)
+    {
+        ::unlink(temporary_path.c_str());
+    }
+
+    return success;
+}
+
+template<typename T>
+bool load_snapshot(const char * path, std::vector<T> & keys, std::uint32_t * log_epoch = nullptr)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable keys can be loaded");
+
+    int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        std::cerr << "Can not open snapshot " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat file_status;
+    Snapshot_header header;
+    bool success = false;
+
+    if (::fstat(fd, &file_status) == 0 &&
+        static_cast<std::uint64_t>(file_status.st_size) >= sizeof(header) &&
+        ::pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)))
+    {
+        success = check_snapshot_header<T>(header, file_status.st_size, path);
+    }
+    else
+    {
+        std::cerr << "Wrong snapshot file " << path << "." << std::endl;
+    }
+
+    if (success)
+    {
+        if (log_epoch != nullptr)
+        {
+            *log_epoch = header.log_epoch_;
+        }
+
+        keys.resize(header.count_);
+
+        char * data = reinterpret_cast<char *>(keys.data());
+        std::uint64_t size = header.count_ * sizeof(T);
+        std::uint64_t offset = 0;
+
+        while (offset < size)
+        {
+            ssize_t count = ::pread(fd, data + offset, size - offset, sizeof(header) + offset);
+
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                std::cerr << "Can not read snapshot " << path << std::endl;
+                success = false;
+                break;
+            }
+
+            offset += count;
+        }
+    }
+
+    ::close(fd);
+
+    return success;
+}
+
+// Read-only snapshot which is mapped into memory. Queries use the sorted keys of the file,
+// nothing is parsed or allocated. Compare has to be the comparator of the saved tree,
+// the file keeps keys in its order.
+template<typename T, typename Compare = std::less<T>>
+class Mapped_snapshot
+{
+    private:
+        void * data_;
+        std::size_t length_;
+        const T * keys_;
+        int size_;
+        [[no_unique_address]] Compare comp_;
+    public:
+        explicit Mapped_snapshot(const char * path, const Compare & comp = Compare());
+        Mapped_snapshot(const Mapped_snapshot<T, Compare> & snapshot) = delete;
+        Mapped_snapshot<T, Compare> & operator=(const Mapped_snapshot<T, Compare> & snapshot) = delete;
+        ~Mapped_snapshot();
+        bool is_open() const;
+        bool is_there(T item) const; // true if there is at least one copy
+        int size() const; // copies of a multiset are counted
+        T k_th_order_statistic(int i) const; // copies are counted
+        int elem_less_than(T item) const; // all copies of smaller keys are counted, as in AVL_multiset
+};
+
+template<typename T, typename Compare>
+Mapped_snapshot<T, Compare>::Mapped_snapshot(const char * path, const Compare & comp) : data_(nullptr),
+                                                                                      length_(0),
+                                                                                      keys_(nullptr),
+                                                                                      size_(0),
+                                                                                      comp_(comp)
+{
+    int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        std::cerr << "Can not open snapshot " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    struct stat file_status;
+
+    if (::fstat(fd, &file_status) == 0 && static_cast<std::uint64_t>(file_status.st_size) >= sizeof(Snapshot_header))
+    {
+        void * data = ::mmap(nullptr, file_status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            std::cerr << "Can not map snapshot " << path << ": " << std::strerror(errno) << std::endl;
+        }
+        else if (!check_snapshot_header<T>(*static_cast<const Snapshot_header *>(data), file_status.st_size, path))
+        {
+            ::munmap(data, file_status.st_size);
+        }
+        else
+        {
+            data_ = data;
+            length_ = file_status.st_size;
+            keys_ = reinterpret_cast<const T *>(static_cast<const char *>(data) + sizeof(Snapshot_header));
+            size_ = static_cast<int>(static_cast<const Snapshot_header *>(data)->count_);
+        }
+    }
+    else
+    {
+        std::cerr << "Wrong snapshot file " << path << "." << std::endl;
+    }
+
+    ::close(fd);
+}
+
+template<typename T, typename Compare>
+Mapped_snapshot<T, Compare>::~Mapped_snapshot()
+{
+    if (data_ != nullptr)
+    {
+        ::munmap(data_, length_);
+    }
+}
+
+template<typename T, typename Compare>
+bool Mapped_snapshot<T, Compare>::is_open() const
+{
+    return data_ != nullptr;
+}
+
+template<typename T, typename Compare>
+bool Mapped_snapshot<T, Compare>::is_there(T item) const
+{
+    const T * bound = std::lower_bound(keys_, keys_ + size_, item, comp_);
+
+    return bound != keys_ + size_ && !comp_(item, *bound);
+}
+
+template<typename T, typename Compare>
+int Mapped_snapshot<T, Compare>::size() const
+{
+    return size_;
+}
+
+template<typename T, typename Compare>
+T Mapped_snapshot<T, Compare>::k_th_order_statistic(int i) const
+{
+    if (i <= 0 || i > size_)
+    {
+        std::cerr << "Uncorrect element number." << std::endl;
+        return T();
+    }
+
+    return keys_[i - 1];
+}
+
+template<typename T, typename Compare>
+int Mapped_snapshot<T, Compare>::elem_less_than(T item) const
+{
+    return static_cast<int>(std::lower_bound(keys_, keys_ + size_, item, comp_) - keys_);
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free queue for one producer thread and one consumer thread.
+// The producer writes only tail_ and the consumer writes only head_, they are in different
+// cache lines, and every side keeps a copy of the index of the other side, so the shared
+// index is read only when the queue looks full or empty. A side which has nothing to do
+// spins for a while and then sleeps in atomic wait until the other side moves its index.
+// A sleeping side waits on its flag, so the other side wakes it only once and does not call
+// notify after every item. Flags are int, atomic wait on them is a futex without a proxy.
+template<typename T>
+class Spsc_queue
+{
+    private:
+        static const std::size_t cache_line_ = 64;
+        static const int spins_ = 256; // attempts before sleeping
+        std::unique_ptr<T[]> items_;
+        std::size_t mask_; // capacity - 1, capacity is a power of two
+        alignas(cache_line_) std::atomic<std::size_t> head_; // next item to pop
+        std::size_t cached_tail_;                            // tail_ seen by the consumer
+        alignas(cache_line_) std::atomic<std::size_t> tail_; // next place to push
+        std::size_t cached_head_;                            // head_ seen by the producer
+        alignas(cache_line_) std::atomic<int> consumer_sleeps_;
+        std::atomic<int> producer_sleeps_;
+        static void sleep(std::atomic<int> & sleeps, const std::atomic<std::size_t> & index, std::size_t old_index);
+        static void wake(std::atomic<int> & sleeps);
+    public:
+        explicit Spsc_queue(std::size_t capacity);
+        Spsc_queue(const Spsc_queue & queue) = delete;
+        Spsc_queue & operator=(const Spsc_queue & queue) = delete;
+        // for the producer
+        bool try_push(const T & item);
+        void push(const T & item); // waits while the queue is full
+        // for the consumer
+        bool try_pop(T & item);
+        void pop(T & item); // waits while the queue is empty
+};
+
+template<typename T>
+Spsc_queue<T>::Spsc_queue(std::size_t capacity) : head_(0),
+                                                  cached_tail_(0),
+                                                  tail_(0),
+                                                  cached_head_(0),
+                                                  consumer_sleeps_(0),
+                                                  producer_sleeps_(0)
+{
+    std::size_t size = 2;
+
+    while (size < capacity)
+        size *= 2;
+
+    items_.reset(new T[size]);
+    mask_ = size - 1;
+}
+
+template<typename T>
+void Spsc_queue<T>::sleep(std::atomic<int> & sleeps, const std::atomic<std::size_t> & index, std::size_t old_index)
+{
+    // the other side either sees the flag after its change of the index or has changed it before the check
+    sleeps.store(1, std::memory_order_seq_cst);
+
+    if (index.load(std::memory_order_seq_cst) == old_index)
+    {
+        sleeps.wait(1, std::memory_order_acquire);
+    }
+
+    sleeps.store(0, std::memory_order_relaxed);
+}
+
+template<typename T>
+void Spsc_queue<T>::wake(std::atomic<int> & sleeps)
+{
+    if (sleeps.load(std::memory_order_seq_cst) != 0 && sleeps.exchange(0, std::memory_order_acq_rel) != 0)
+    {
+        sleeps.notify_one();
+    }
+}
+
+template<typename T>
+bool Spsc_queue<T>::try_push(const T & item)
+{
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - cached_head_ > mask_)
+    {
+        cached_head_ = head_.load(std::memory_order_acquire);
+
+        if (tail - cached_head_ > mask_)
+        {
+            return false;
+        }
+    }
+
+    items_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_seq_cst);
+    wake(consumer_sleeps_);
+
+    return true;
+}
+
+template<typename T>
+void Spsc_queue<T>::push(const T & item)
+{
+    for (int i = 0; !try_push(item); ++i)
+    {
+        if (i >= spins_)
+        {
+            // the consumer moves head_ when it takes an item
+            sleep(producer_sleeps_, head_, cached_head_);
+        }
+    }
+}
+
+template<typename T>
+bool Spsc_queue<T>::try_pop(T & item)
+{
+    std::size_t head = head_.load(std::memory_order_relaxed);
+
+    if (head == cached_tail_)
+    {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+
+        if (head == cached_tail_)
+        {
+            return false;
+        }
+    }
+
+    item = items_[head & mask_];
+    head_.store(head + 1, std::memory_order_seq_cst);
+    wake(producer_sleeps_);
+
+    return true;
+}
+
+template<typename T>
+void Spsc_queue<T>::pop(T & item)
+{
+    for (int i = 0; !try_pop(item); ++i)
+    {
+        if (i >= spins_)
+        {
+            // the producer moves tail_ when it adds an item
+            sleep(consumer_sleeps_, tail_, cached_tail_);
+        }
+    }
+}
+
+#endif
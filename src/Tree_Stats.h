@@ -0,0 +1,117 @@
+#ifndef TREE_STATS_H_
+#define TREE_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Counters of the tree are compiled only with AVL_TREE_STATS,
+// without it AVL_STATS(...) is empty and costs nothing.
+#ifdef AVL_TREE_STATS
+#define AVL_STATS(statement) statement
+#else
+#define AVL_STATS(statement)
+#endif
+
+struct Tree_stats
+{
+    std::uint64_t l_rotations_ = 0;
+    std::uint64_t r_rotations_ = 0;
+    std::uint64_t lr_rotations_ = 0;
+    std::uint64_t rl_rotations_ = 0;
+    std::uint64_t descents_ = 0;      // searches from the root: inserts, removes and queries
+    std::uint64_t visited_nodes_ = 0; // nodes visited by descents
+    std::uint64_t duplicates_ = 0;    // inserts of values which were already in the tree
+    int size_ = 0;
+    int height_ = 0;
+    void write_json(std::ostream & os) const
+    {
+        os << "{\"l_rotations\": " << l_rotations_
+           << ", \"r_rotations\": " << r_rotations_
+           << ", \"lr_rotations\": " << lr_rotations_
+           << ", \"rl_rotations\": " << rl_rotations_
+           << ", \"descents\": " << descents_
+           << ", \"visited_nodes\": " << visited_nodes_
+           << ", \"visited_per_descent\": " << (descents_ == 0 ? 0.0 : static_cast<double>(visited_nodes_) / descents_)
+           << ", \"duplicates\": " << duplicates_
+           << ", \"size\": " << size_
+           << ", \"height\": " << height_ << "}";
+    }
+};
+
+// Histogram of latencies in nanoseconds like HdrHistogram: every power of two
+// is divided into 32 buckets, so a value is kept with an error less than 3%.
+class Latency_histogram
+{
+    private:
+        static const int sub_bucket_bits_ = 5;
+        static const int sub_buckets_ = 1 << sub_bucket_bits_;
+        static const int buckets_ = (64 - sub_bucket_bits_ + 1) * sub_buckets_;
+        std::uint64_t counts_[buckets_] = {};
+        std::uint64_t count_ = 0;
+        std::uint64_t min_ = UINT64_MAX;
+        std::uint64_t max_ = 0;
+        double sum_ = 0;
+        static int index(std::uint64_t value)
+        {
+            if (value < static_cast<std::uint64_t>(sub_buckets_))
+            {
+                return static_cast<int>(value);
+            }
+
+            int exponent = 63 - __builtin_clzll(value);
+            int sub_bucket = static_cast<int>(value >> (exponent - sub_bucket_bits_)) & (sub_buckets_ - 1);
+
+            return (exponent - sub_bucket_bits_ + 1) * sub_buckets_ + sub_bucket;
+        }
+        static std::uint64_t value(int index) // the smallest value of the bucket
+        {
+            if (index < sub_buckets_)
+            {
+                return index;
+            }
+
+            int exponent = index / sub_buckets_ + sub_bucket_bits_ - 1;
+            std::uint64_t sub_bucket = index % sub_buckets_;
+
+            return (static_cast<std::uint64_t>(sub_buckets_) | sub_bucket) << (exponent - sub_bucket_bits_);
+        }
+    public:
+        void record(std::uint64_t nanoseconds)
+        {
+            ++counts_[index(nanoseconds)];
+            ++count_;
+            sum_ += nanoseconds;
+            min_ = nanoseconds < min_ ? nanoseconds : min_;
+            max_ = nanoseconds > max_ ? nanoseconds : max_;
+        }
+        std::uint64_t percentile(double percent) const
+        {
+            std::uint64_t rank = static_cast<std::uint64_t>(percent / 100.0 * count_ + 0.5);
+            std::uint64_t seen = 0;
+
+            for (int i = 0; i < buckets_; ++i)
+            {
+                seen += counts_[i];
+
+                if (seen >= rank && seen > 0)
+                {
+                    return value(i) < max_ ? value(i) : max_;
+                }
+            }
+            return max_;
+        }
+        void write_json(std::ostream & os) const
+        {
+            os << "{\"count\": " << count_
+               << ", \"min_ns\": " << (count_ == 0 ? 0 : min_)
+               << ", \"mean_ns\": " << (count_ == 0 ? 0.0 : sum_ / count_)
+               << ", \"p50_ns\": " << percentile(50)
+               << ", \"p90_ns\": " << percentile(90)
+               << ", \"p99_ns\": " << percentile(99)
+               << ", \"p999_ns\": " << percentile(99.9)
+               << ", \"max_ns\": " << max_ << "}";
+        }
+};
+
+#endif
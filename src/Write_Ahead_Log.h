@@ -0,0 +1,344 @@
+#ifndef WRITE_AHEAD_LOG_H_
+#define WRITE_AHEAD_LOG_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Append-only log of changes of a tree. Changes are collected into batches,
+// every batch is written as one record with a checksum:
+//     magic | count | epoch | checksum | count entries of (operation, key)
+// A record which was not written completely before a crash fails the check,
+// so the log is replayed up to it and cut there.
+// Every reset starts the next epoch. A snapshot keeps the epoch of the log after its reset,
+// so if the process stops between saving of the snapshot and the reset,
+// records of older epochs are skipped by the next replay instead of being applied twice.
+// A change waits for the disk not longer than sync_interval: a partial batch is written when
+// sync_interval has passed since its first change or when the program waits for input (idle).
+template<typename T>
+class Write_ahead_log
+{
+    private:
+        struct Record_header
+        {
+            std::uint32_t magic_;
+            std::uint32_t count_;
+            std::uint32_t epoch_;
+            std::uint32_t checksum_;
+        };
+        static const std::uint32_t record_magic_ = 0x4c415741; // "AWAL"
+        static const std::size_t entry_size_ = 1 + sizeof(T);
+        std::string path_;
+        int fd_;
+        std::size_t batch_size_;  // entries in one record
+        std::chrono::milliseconds sync_interval_; // the longest time from a change to its fdatasync
+        std::chrono::steady_clock::time_point oldest_; // of the first change which is not synced
+        std::vector<char> record_; // the header and entries of the current batch
+        std::size_t count_;
+        bool synced_; // all written records are synced
+        std::uint32_t epoch_; // of new records
+        static std::uint32_t checksum(const char * data, std::size_t size, std::uint32_t count, std::uint32_t epoch);
+        void append(char operation, const T & item);
+        bool write_all(const char * data, std::size_t size);
+        void error(const char * action);
+    public:
+        static const char insert_operation_ = 'k';
+        static const char remove_operation_ = 'r';
+        Write_ahead_log(std::size_t batch_size, int sync_interval); // sync_interval in milliseconds
+        Write_ahead_log(const Write_ahead_log<T> & log) = delete;
+        Write_ahead_log<T> & operator=(const Write_ahead_log<T> & log) = delete;
+        ~Write_ahead_log();
+        // replays the log by apply(operation, key) and opens it for appending,
+        // records of epochs before first_epoch are already in the snapshot
+        template<typename Function>
+        bool open(const char * path, Function apply, std::uint32_t first_epoch = 0);
+        void insert(const T & item);
+        void remove(const T & item);
+        bool flush(); // writes the current batch, syncs if sync_interval has passed since the oldest change
+        // flush while there is nothing else to do, returns milliseconds until the next sync is due
+        // or -1 if all changes are synced
+        int idle();
+        bool sync();  // writes the current batch and syncs it at once
+        bool reset(); // makes the log empty after its changes were saved in a snapshot, starts the next epoch
+        std::uint32_t epoch() const;
+};
+
+template<typename T>
+Write_ahead_log<T>::Write_ahead_log(std::size_t batch_size, int sync_interval) : fd_(-1),
+                                                                                batch_size_(batch_size == 0 ? 1 : batch_size),
+                                                                                sync_interval_(sync_interval),
+                                                                                oldest_(std::chrono::steady_clock::now()),
+                                                                                record_(sizeof(Record_header)),
+                                                                                count_(0),
+                                                                                synced_(true),
+                                                                                epoch_(0)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable keys can be logged");
+
+    record_.reserve(sizeof(Record_header) + batch_size_ * entry_size_);
+}
+
+template<typename T>
+Write_ahead_log<T>::~Write_ahead_log()
+{
+    if (fd_ != -1)
+    {
+        sync();
+        ::close(fd_);
+    }
+}
+
+template<typename T>
+std::uint32_t Write_ahead_log<T>::checksum(const char * data, std::size_t size, std::uint32_t count, std::uint32_t epoch)
+{
+    // FNV-1a of the entries, their quantity and epoch
+    std::uint32_t hash = ((2166136261u ^ count) * 16777619u) ^ epoch;
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+template<typename T>
+void Write_ahead_log<T>::error(const char * action)
+{
+    std::cerr << "Can not " << action << " log " << path_ << ": " << std::strerror(errno) << std::endl;
+}
+
+template<typename T>
+bool Write_ahead_log<T>::write_all(const char * data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t count = ::write(fd_, data, size);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            error("write");
+            return false;
+        }
+
+        data += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+template<typename T>
+template<typename Function>
+bool Write_ahead_log<T>::open(const char * path, Function apply, std::uint32_t first_epoch)
+{
+    path_ = path;
+    fd_ = ::open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd_ == -1)
+    {
+        error("open");
+        return false;
+    }
+
+    struct stat file_status;
+
+    if (::fstat(fd_, &file_status) != 0)
+    {
+        error("read");
+        return false;
+    }
+
+    // records are replayed while they are complete and correct
+    std::uint64_t file_size = file_status.st_size;
+    std::uint64_t offset = 0;
+    std::vector<char> entries;
+    Record_header header;
+    epoch_ = first_epoch;
+
+    while (file_size - offset >= sizeof(header) &&
+           ::pread(fd_, &header, sizeof(header), offset) == static_cast<ssize_t>(sizeof(header)) &&
+           header.magic_ == record_magic_ &&
+           header.count_ <= (file_size - offset - sizeof(header)) / entry_size_)
+    {
+        entries.resize(header.count_ * entry_size_);
+
+        if (::pread(fd_, entries.data(), entries.size(), offset + sizeof(header)) != static_cast<ssize_t>(entries.size()) ||
+            checksum(entries.data(), entries.size(), header.count_, header.epoch_) != header.checksum_)
+        {
+            break;
+        }
+
+        offset += sizeof(header) + entries.size();
+
+        if (header.epoch_ < first_epoch)
+        {
+            continue;
+        }
+
+        epoch_ = header.epoch_;
+
+        for (const char * entry = entries.data(); entry != entries.data() + entries.size(); entry += entry_size_)
+        {
+            T item;
+            std::memcpy(&item, entry + 1, sizeof(T));
+            apply(entry[0], item);
+        }
+    }
+
+    // the rest of the file was not written completely
+    if (offset != file_size && ::ftruncate(fd_, offset) != 0)
+    {
+        error("cut");
+        return false;
+    }
+
+    ::lseek(fd_, offset, SEEK_SET);
+
+    return true;
+}
+
+template<typename T>
+void Write_ahead_log<T>::append(char operation, const T & item)
+{
+    record_.push_back(operation);
+    record_.resize(record_.size() + sizeof(T));
+    std::memcpy(record_.data() + record_.size() - sizeof(T), &item, sizeof(T));
+
+    if (count_ == 0 && synced_)
+    {
+        oldest_ = std::chrono::steady_clock::now();
+    }
+
+    // with the zero interval a record is synced as soon as it is written, so only full batches are written here
+    if (++count_ == batch_size_ ||
+        (sync_interval_.count() > 0 && std::chrono::steady_clock::now() - oldest_ >= sync_interval_))
+    {
+        flush();
+    }
+}
+
+template<typename T>
+void Write_ahead_log<T>::insert(const T & item)
+{
+    append(insert_operation_, item);
+}
+
+template<typename T>
+void Write_ahead_log<T>::remove(const T & item)
+{
+    append(remove_operation_, item);
+}
+
+template<typename T>
+bool Write_ahead_log<T>::flush()
+{
+    bool success = true;
+
+    if (count_ > 0)
+    {
+        // the whole batch goes to the file by one write
+        Record_header header;
+        header.magic_ = record_magic_;
+        header.count_ = static_cast<std::uint32_t>(count_);
+        header.epoch_ = epoch_;
+        header.checksum_ = checksum(record_.data() + sizeof(header), record_.size() - sizeof(header), header.count_, header.epoch_);
+        std::memcpy(record_.data(), &header, sizeof(header));
+
+        success = write_all(record_.data(), record_.size());
+        record_.resize(sizeof(header));
+        count_ = 0;
+        synced_ = false;
+    }
+
+    // group commit: one fdatasync for all records of the interval
+    if (success && !synced_ && std::chrono::steady_clock::now() - oldest_ >= sync_interval_)
+    {
+        success = sync();
+    }
+
+    return success;
+}
+
+template<typename T>
+bool Write_ahead_log<T>::sync()
+{
+    if (count_ > 0)
+    {
+        // a batch is written by flush, it syncs at once with the zero interval
+        std::chrono::milliseconds sync_interval = sync_interval_;
+        sync_interval_ = std::chrono::milliseconds(0);
+        bool success = flush();
+        sync_interval_ = sync_interval;
+
+        return success;
+    }
+
+    if (!synced_)
+    {
+        if (::fdatasync(fd_) != 0)
+        {
+            error("sync");
+            return false;
+        }
+
+        synced_ = true;
+    }
+
+    return true;
+}
+
+template<typename T>
+int Write_ahead_log<T>::idle()
+{
+    if (!flush() || synced_)
+    {
+        return -1;
+    }
+
+    std::chrono::nanoseconds left = sync_interval_ - (std::chrono::steady_clock::now() - oldest_);
+
+    return std::max(0, static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(left).count()));
+}
+
+template<typename T>
+bool Write_ahead_log<T>::reset()
+{
+    // even if the log is not cleared, its records are in the snapshot of the new epoch
+    record_.resize(sizeof(Record_header));
+    count_ = 0;
+    ++epoch_;
+
+    if (::ftruncate(fd_, 0) != 0 || ::lseek(fd_, 0, SEEK_SET) != 0 || ::fdatasync(fd_) != 0)
+    {
+        error("reset");
+        return false;
+    }
+
+    synced_ = true;
+
+    return true;
+}
+
+template<typename T>
+std::uint32_t Write_ahead_log<T>::epoch() const
+{
+    return epoch_;
+}
+
+#endif
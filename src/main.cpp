@@ -1,128 +1,706 @@
 #include "AVL_Tree.h"
-#include <iostream>
+#include "AVL_Multiset.h"
+#include "Command_Reader.h"
+#include "Output_Buffer.h"
+#include "Sharded_AVL_Tree.h"
+#include "Spsc_Queue.h"
+#include "Write_Ahead_Log.h"
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 #include <vector>
+#ifdef AVL_TREE_STATS
+#include <csignal>
+#include <fstream>
+#include <sstream>
+#include <string>
+#endif
+
+using Tree_set = AVL_tree<int, std::less<int>, Node_pool<int>>;
+using Tree_multiset = AVL_multiset<int, std::less<int>, Node_pool<int>>;
+
+struct Options
+{
+    char separator_ = ' ';
+    bool quiet_ = false;
+    const char * log_name_ = nullptr;
+    const char * snapshot_name_ = nullptr;
+    int sync_interval_ = 0;
+    int batch_size_ = 1024;
+    const char * stats_name_ = nullptr;
+    int threads_ = 1;
+    bool pipeline_ = false;
+};
+
+// commands go between the stages of the pipeline by batches
+struct Command_batch
+{
+    static const int size_ = 4096;
+    Command commands_[size_];
+    Command_result results_[size_];
+    int count_ = 0;
+    bool last_ = false;     // there are no commands after this batch
+    int missed_spaces_ = 0; // after the last command
+    bool bad_input_ = false;
+    int tree_size_ = 0;     // after the batch, for the message about bad input
+#ifdef AVL_TREE_STATS
+    std::string stats_;     // stats which were requested by SIGUSR1 while the batch was executed
+#endif
+};
 
-void result(AVL_tree<int> & tree_, char alpha_, int value_ );
+template<typename Tree>
+int run(int fd_, const Options & options_);
+template<typename Tree>
+int run_sharded(int fd_, const Options & options_);
+template<typename Tree>
+int run_pipeline(int fd_, const Options & options_);
+template<typename Tree>
+bool recover(Tree & tree_, Write_ahead_log<int> & log_, const Options & options_, std::uint32_t & log_epoch_);
+template<typename Tree>
+void save(const Tree & tree_, Write_ahead_log<int> & log_, const Options & options_, std::uint32_t log_epoch_);
+int read_batch(Command_reader & reader_, Command & command_, bool & more_, Command * batch_, int size_, bool partial_ = false);
+void wait_for_input(Command_reader & reader_, Write_ahead_log<int> & log_);
+void pop_batch(Spsc_queue<Command_batch *> & batches_, Write_ahead_log<int> * log_, Command_batch * & batch_);
+template<typename Tree>
+void execute(Tree & tree_, const Command & command_, Command_result & result_);
+void write_results(const Command * commands_, const Command_result * results_, int count_, Output_buffer & output_,
+                   Write_ahead_log<int> * log_, bool quiet_, std::size_t & duplicates_);
+template<typename Tree>
+void result(Tree & tree_, Output_buffer & output_, Write_ahead_log<int> * log_, char alpha_, int value_ );
+bool insert_value(Tree_set & tree_, int value_);
+bool insert_value(Tree_multiset & tree_, int value_);
 void message1();
 void message2();
 void message3();
 void message4();
-void message5(const AVL_tree<int> & tree_);
+void message5(int size_);
+void message6(const char * program_);
+void message7(std::size_t duplicates_);
+void message8(int value_);
+void message9();
 
+#ifdef AVL_TREE_STATS
+// SIGUSR1 only sets the flag, the stats are written between commands
+volatile std::sig_atomic_t stats_requested = 0;
 
-int main()
-{
-    char alpha;
-    int value;
-    AVL_tree<int> tree;
+void request_stats(int);
+template<typename Tree>
+std::string format_stats(const Tree & tree_, const Latency_histogram latencies_[]);
+template<typename Tree>
+void write_stats(const Tree & tree_, const Latency_histogram latencies_[], const char * stats_name_);
+void write_stats_line(const std::string & line_, const char * stats_name_);
+#endif
 
-    char space = ' ';
 
-    do
+int main(int argc, char * argv[])
+{
+    const char * file_name = nullptr;
+    bool multiset = false;
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
     {
-        if (space == '\n')
+        if ((std::strcmp(argv[i], "-f") == 0 || std::strcmp(argv[i], "--file") == 0) && i + 1 < argc)
         {
-            break;
+            // read commands from a file instead of stdin
+            file_name = argv[++i];
         }
-        else if (space == ' ')
+        else if (std::strcmp(argv[i], "--newline") == 0)
         {
-            std::cin.get(alpha);
+            // every result in its own line
+            options.separator_ = '\n';
         }
-        else if (isalpha(space))
+        else if (std::strcmp(argv[i], "--quiet") == 0)
         {
-            message1();
-            alpha = space;
+            // count values which are already in the tree instead of a message about every one
+            options.quiet_ = true;
+        }
+        else if (std::strcmp(argv[i], "--multiset") == 0)
+        {
+            // values which are already in the tree are inserted again and counted by 'm' and 'n'
+            multiset = true;
+        }
+        else if (std::strcmp(argv[i], "--wal") == 0 && i + 1 < argc)
+        {
+            // log inserts to recover them after a crash
+            options.log_name_ = argv[++i];
         }
+        else if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc)
+        {
+            // load the tree at start and save it at the end
+            options.snapshot_name_ = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--sync-interval") == 0 && i + 1 < argc)
+        {
+            // milliseconds between syncs of the log
+            options.sync_interval_ = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--wal-batch") == 0 && i + 1 < argc)
+        {
+            // inserts in one record of the log
+            options.batch_size_ = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--pipeline") == 0)
+        {
+            // reading, execution and output in their own threads
+            options.pipeline_ = true;
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            // shards of the keys with their own threads
+            options.threads_ = std::atoi(argv[++i]);
+        }
+#ifdef AVL_TREE_STATS
+        else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+        {
+            // JSON lines of stats are appended to the file instead of stderr
+            options.stats_name_ = argv[++i];
+        }
+#endif
+        else
+        {
+            message6(argv[0]);
+            return 1;
+        }
+    }
 
-        if (!std::cin)
+    // the sharded mode keeps neither a log nor a snapshot nor stats, it reads and executes at the same time itself
+    if (options.threads_ < 1 || (options.threads_ > 1 && (options.log_name_ != nullptr ||
+                                                           options.snapshot_name_ != nullptr ||
+                                                           options.stats_name_ != nullptr ||
+                                                           options.pipeline_)))
+    {
+        message6(argv[0]);
+        return 1;
+    }
+
+    int fd = STDIN_FILENO;
+
+    if (file_name != nullptr)
+    {
+        fd = open(file_name, O_RDONLY);
+
+        if (fd == -1)
         {
-            std::cin.clear();
+            std::cerr << "Can not open file " << file_name << ": " << std::strerror(errno) << '\n';
+            return 1;
         }
+    }
+
+    int status = 0;
+
+    if (options.threads_ > 1)
+    {
+        status = multiset ? run_sharded<Tree_multiset>(fd, options) : run_sharded<Tree_set>(fd, options);
+    }
+    else if (options.pipeline_)
+    {
+        status = multiset ? run_pipeline<Tree_multiset>(fd, options) : run_pipeline<Tree_set>(fd, options);
+    }
+    else
+    {
+        status = multiset ? run<Tree_multiset>(fd, options) : run<Tree_set>(fd, options);
+    }
+
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+
+    return status;
+}
+
+template<typename Tree>
+int run(int fd_, const Options & options_)
+{
+    Tree tree;
+    Command_reader reader(fd_);
+    Command command;
+    Write_ahead_log<int> log(options_.batch_size_ > 0 ? options_.batch_size_ : 1, options_.sync_interval_ > 0 ? options_.sync_interval_ : 0);
+    std::uint32_t log_epoch = 0;
+
+    if (!recover(tree, log, options_, log_epoch))
+    {
+        return 1;
+    }
+
+    // values which were inserted again by the replay are not reported
+    std::size_t recovered_duplicates = tree.duplicates();
+    tree.set_quiet(options_.quiet_);
+    Output_buffer output(STDOUT_FILENO, options_.separator_);
+    std::ostream output_stream(&output);
+
+    // results have to be written before any message like with std::cout
+    std::cerr.tie(&output_stream);
+
+#ifdef AVL_TREE_STATS
+    // latencies of 'k', 'm' and 'n' commands
+    static Latency_histogram latencies[3];
+    const char letters[] = "kmn";
+    std::signal(SIGUSR1, request_stats);
+#endif
+
+    while (reader.next(command))
+    {
+        for (int i = 0; i < command.missed_spaces_; ++i)
+            message1();
+
+#ifdef AVL_TREE_STATS
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
 
-        std::cin.get(space);
+        // output the result
+        result(tree, output, options_.log_name_ != nullptr ? &log : nullptr, command.letter_, command.value_);
 
-        if (space == '\n')
+#ifdef AVL_TREE_STATS
+        const char * letter = std::strchr(letters, command.letter_);
+
+        if (command.letter_ != '\0' && letter != nullptr)
         {
-            break;
+            std::chrono::nanoseconds latency = std::chrono::steady_clock::now() - start;
+            latencies[letter - letters].record(latency.count());
         }
-        // enter a number
-        else if (space == ' ' && std::cin >> value)
+
+        if (stats_requested)
         {
-            // output the result
-            result(tree, alpha, value);
-            std::cin.get(space);
+            stats_requested = 0;
+            write_stats(tree, latencies, options_.stats_name_);
         }
-        else if (!std::cin)
+#endif
+
+        if (options_.log_name_ != nullptr)
         {
-            std::cin.clear();
-            break;
+            wait_for_input(reader, log);
         }
-        else if(space == '-')
+    }
+
+    for (int i = 0; i < command.missed_spaces_; ++i)
+        message1();
+
+    if (reader.bad_input())
+    {
+        message5(tree.size());
+    }
+
+    output.finish();
+    std::cerr.tie(&std::cout);
+
+    if (tree.duplicates() > recovered_duplicates && options_.quiet_)
+    {
+        message7(tree.duplicates() - recovered_duplicates);
+    }
+
+#ifdef AVL_TREE_STATS
+    write_stats(tree, latencies, options_.stats_name_);
+#endif
+
+    save(tree, log, options_, log_epoch);
+
+    return 0;
+}
+
+template<typename Tree>
+int run_sharded(int fd_, const Options & options_)
+{
+    static const int batch_size = 1 << 16;
+    Sharded_AVL_tree<Tree> tree(options_.threads_);
+    Command_reader reader(fd_);
+    Command command;
+    bool more = true;
+    std::size_t duplicates = 0;
+    // the next batch is read while shards execute the current one
+    std::vector<Command> batches[2] = {std::vector<Command>(batch_size), std::vector<Command>(batch_size)};
+    std::vector<Command_result> results(batch_size);
+    int current = 0;
+    Output_buffer output(STDOUT_FILENO, options_.separator_);
+    std::ostream output_stream(&output);
+
+    std::cerr.tie(&output_stream);
+
+    int count = read_batch(reader, command, more, batches[current].data(), batch_size);
+
+    while (count > 0)
+    {
+        tree.start(batches[current].data(), count, results.data());
+        int next_count = read_batch(reader, command, more, batches[1 - current].data(), batch_size);
+        tree.finish();
+
+        write_results(batches[current].data(), results.data(), count, output, nullptr, options_.quiet_, duplicates);
+        current = 1 - current;
+        count = next_count;
+    }
+
+    for (int i = 0; i < command.missed_spaces_; ++i)
+        message1();
+
+    if (reader.bad_input())
+    {
+        message5(tree.size());
+    }
+
+    output.finish();
+    std::cerr.tie(&std::cout);
+
+    if (duplicates > 0 && options_.quiet_)
+    {
+        message7(duplicates);
+    }
+
+    return 0;
+}
+
+template<typename Tree>
+int run_pipeline(int fd_, const Options & options_)
+{
+    static const int batches_quantity = 16;
+    Tree tree;
+    Command_reader reader(fd_);
+    Write_ahead_log<int> log(options_.batch_size_ > 0 ? options_.batch_size_ : 1, options_.sync_interval_ > 0 ? options_.sync_interval_ : 0);
+    Write_ahead_log<int> * log_pointer = options_.log_name_ != nullptr ? &log : nullptr;
+    std::uint32_t log_epoch = 0;
+
+    if (!recover(tree, log, options_, log_epoch))
+    {
+        return 1;
+    }
+
+    // messages about values which are already in the tree are written by the writer in their order
+    tree.set_quiet(true);
+
+    // the reader takes only free batches, so it waits while the executor or the writer is behind
+    std::vector<std::unique_ptr<Command_batch>> batches;
+    Spsc_queue<Command_batch *> free_batches(batches_quantity);
+    Spsc_queue<Command_batch *> parsed_batches(batches_quantity);
+    Spsc_queue<Command_batch *> executed_batches(batches_quantity);
+    std::size_t duplicates = 0;
+
+    for (int i = 0; i < batches_quantity; ++i)
+    {
+        batches.emplace_back(new Command_batch());
+        free_batches.push(batches.back().get());
+    }
+
+#ifdef AVL_TREE_STATS
+    // latencies of 'k', 'm' and 'n' commands
+    static Latency_histogram latencies[3];
+    std::signal(SIGUSR1, request_stats);
+#endif
+
+    // the executor is the only thread which uses the tree
+    std::thread executor([&tree, &parsed_batches, &executed_batches]()
+    {
+        Command_batch * batch = nullptr;
+        bool last = false;
+
+        // a batch belongs to the next stage after push, so last_ is read before it
+        while (!last)
         {
-            // space is forgotten
-            message1();
+            parsed_batches.pop(batch);
+
+            for (int i = 0; i < batch->count_; ++i)
+            {
+#ifdef AVL_TREE_STATS
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
+
+                execute(tree, batch->commands_[i], batch->results_[i]);
 
-            std::vector<int> buffer;
-            value = 0;
+#ifdef AVL_TREE_STATS
+                const char letters[] = "kmn";
+                const char * letter = std::strchr(letters, batch->commands_[i].letter_);
 
-            while(std::cin.get(space) && isdigit(space) )
-                buffer.push_back(atoi(const_cast<const char *>(&space)));
+                if (batch->commands_[i].letter_ != '\0' && letter != nullptr)
+                {
+                    std::chrono::nanoseconds latency = std::chrono::steady_clock::now() - start;
+                    latencies[letter - letters].record(latency.count());
+                }
+#endif
+            }
 
-            auto it = buffer.rbegin();
+            batch->tree_size_ = tree.size();
 
-            for(int i = 0; it != buffer.rend(); ++it, ++i)
-                value += (*it) * std::pow(10, i);
+#ifdef AVL_TREE_STATS
+            // the writer writes them, so they do not go to stderr between its messages
+            if (stats_requested)
+            {
+                stats_requested = 0;
+                batch->stats_ = format_stats(tree, latencies);
+            }
+#endif
 
-            // output the result
-            result(tree, alpha, -1 * value);
+            last = batch->last_;
+            executed_batches.push(batch);
         }
-        else if (isdigit(space))
+    });
+
+    // the writer writes results, messages and the log in the order of commands
+    std::thread writer([&options_, &executed_batches, &free_batches, log_pointer, &duplicates]()
+    {
+        Output_buffer output(STDOUT_FILENO, options_.separator_);
+        std::ostream output_stream(&output);
+        Command_batch * batch = nullptr;
+
+        std::cerr.tie(&output_stream);
+
+        while (true)
         {
-            // space is forgotten
+            pop_batch(executed_batches, log_pointer, batch);
+            write_results(batch->commands_, batch->results_, batch->count_, output, log_pointer, options_.quiet_, duplicates);
+
+#ifdef AVL_TREE_STATS
+            if (!batch->stats_.empty())
+            {
+                write_stats_line(batch->stats_, options_.stats_name_);
+                batch->stats_.clear();
+            }
+#endif
+
+            if (batch->last_)
+            {
+                break;
+            }
+
+            free_batches.push(batch);
+        }
+
+        for (int i = 0; i < batch->missed_spaces_; ++i)
             message1();
 
-            std::vector<int> buffer;
-            buffer.push_back(atoi(const_cast<const char *>(&space)));
-            value = 0;
+        if (batch->bad_input_)
+        {
+            message5(batch->tree_size_);
+        }
+
+        output.finish();
+        std::cerr.tie(&std::cout);
+    });
+
+    // the calling thread is the reader
+    Command command;
+    bool more = true;
+
+    while (more)
+    {
+        Command_batch * batch = nullptr;
+        free_batches.pop(batch);
+
+        // commands which came before a pause of the input go further at once
+        batch->count_ = read_batch(reader, command, more, batch->commands_, Command_batch::size_, true);
+        batch->last_ = !more;
+        batch->missed_spaces_ = command.missed_spaces_;
+        batch->bad_input_ = reader.bad_input();
+        parsed_batches.push(batch);
+    }
+
+    executor.join();
+    writer.join();
+
+    if (duplicates > 0 && options_.quiet_)
+    {
+        message7(duplicates);
+    }
+
+#ifdef AVL_TREE_STATS
+    write_stats(tree, latencies, options_.stats_name_);
+#endif
+
+    save(tree, log, options_, log_epoch);
+
+    return 0;
+}
+
+template<typename Tree>
+bool recover(Tree & tree_, Write_ahead_log<int> & log_, const Options & options_, std::uint32_t & log_epoch_)
+{
+    // recovery: the last snapshot and then changes from the log which are not in it
+    if (options_.snapshot_name_ != nullptr && access(options_.snapshot_name_, F_OK) == 0 &&
+        !tree_.load(options_.snapshot_name_, &log_epoch_))
+    {
+        return false;
+    }
+
+    tree_.set_quiet(true);
+
+    return options_.log_name_ == nullptr || log_.open(options_.log_name_, [&tree_](char operation_, int value_)
+        {
+            if (operation_ == Write_ahead_log<int>::insert_operation_)
+            {
+                tree_.insert(value_);
+            }
+            else if (tree_.is_there(value_))
+            {
+                tree_.remove(value_);
+            }
+        }, log_epoch_);
+}
+
+template<typename Tree>
+void save(const Tree & tree_, Write_ahead_log<int> & log_, const Options & options_, std::uint32_t log_epoch_)
+{
+    if (options_.snapshot_name_ == nullptr)
+    {
+        return;
+    }
+
+    // without a log the snapshot keeps the old epoch, so an old log is still skipped
+    if (options_.log_name_ == nullptr)
+    {
+        tree_.save(options_.snapshot_name_, log_epoch_);
+        return;
+    }
+
+    // all changes are in the new snapshot, so the log starts again from the next epoch
+    if (tree_.save(options_.snapshot_name_, log_.epoch() + 1))
+    {
+        log_.reset();
+    }
+}
+
+int read_batch(Command_reader & reader_, Command & command_, bool & more_, Command * batch_, int size_, bool partial_)
+{
+    int count = 0;
+
+    // after the last command the reader is not asked again, command_ keeps missed spaces at the end,
+    // a partial batch ends when the input has to be waited for
+    while (more_ && count < size_ && (!partial_ || count == 0 || reader_.buffered() || reader_.wait(0)) &&
+           (more_ = reader_.next(command_)))
+        batch_[count++] = command_;
+
+    return count;
+}
 
-            while(std::cin.get(space) && isdigit(space) )
-                buffer.push_back(atoi(const_cast<const char *>(&space)));
+void wait_for_input(Command_reader & reader_, Write_ahead_log<int> & log_)
+{
+    if (reader_.buffered() || reader_.wait(0))
+    {
+        return;
+    }
 
-            auto it = buffer.rbegin();
+    // while the input waits, the log is written and synced in time
+    int timeout = log_.idle();
 
-            for(int i = 0; it != buffer.rend(); ++it, ++i)
-                value += (*it) * std::pow(10, i);
+    while (timeout >= 0 && !reader_.wait(timeout))
+        timeout = log_.idle();
+}
 
-            // output the result
-            result(tree, alpha, value);
+void pop_batch(Spsc_queue<Command_batch *> & batches_, Write_ahead_log<int> * log_, Command_batch * & batch_)
+{
+    if (log_ == nullptr)
+    {
+        batches_.pop(batch_);
+        return;
+    }
+
+    // while the next batch is not ready, the log is written and synced in time
+    while (!batches_.try_pop(batch_))
+    {
+        if (log_->idle() < 0)
+        {
+            batches_.pop(batch_);
+            return;
         }
-        else
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+template<typename Tree>
+void execute(Tree & tree_, const Command & command_, Command_result & result_)
+{
+    result_.value_ = 0;
+    result_.done_ = false;
+
+    if (command_.letter_ == 'k')
+    {
+        result_.done_ = insert_value(tree_, command_.value_);
+    }
+    else if (command_.letter_ == 'm')
+    {
+        // a wrong number is reported by the writer
+        if (command_.value_ > 0 && command_.value_ <= tree_.size())
         {
-            message5(tree);
-            break;
+            result_.value_ = tree_.k_th_order_statistic(command_.value_);
+            result_.done_ = true;
         }
+    }
+    else if (command_.letter_ == 'n')
+    {
+        result_.value_ = tree_.elem_less_than(command_.value_);
+    }
+}
+
+void write_results(const Command * commands_, const Command_result * results_, int count_, Output_buffer & output_,
+                   Write_ahead_log<int> * log_, bool quiet_, std::size_t & duplicates_)
+{
+    // results and messages in the order of commands
+    for (int i = 0; i < count_; ++i)
+    {
+        for (int j = 0; j < commands_[i].missed_spaces_; ++j)
+            message1();
 
-    } while(alpha != '\n' && space != '\n');
+        if (commands_[i].letter_ == 'k')
+        {
+            if (results_[i].done_)
+            {
+                if (log_ != nullptr)
+                {
+                    log_->insert(commands_[i].value_);
+                }
+            }
+            else
+            {
+                ++duplicates_;
 
-    std::cout << std::endl;
+                if (!quiet_)
+                {
+                    message8(commands_[i].value_);
+                }
+            }
+        }
+        else if (commands_[i].letter_ == 'm')
+        {
+            if (!results_[i].done_)
+            {
+                message9();
+            }
 
-    return 0;
+            output_.write(results_[i].value_);
+        }
+        else if (commands_[i].letter_ == 'n')
+        {
+            output_.write(results_[i].value_);
+        }
+        else
+        {
+            message3();
+        }
+    }
 }
 
-void result(AVL_tree<int> & tree_, char alpha_, int value_ )
+template<typename Tree>
+void result(Tree & tree_, Output_buffer & output_, Write_ahead_log<int> * log_, char alpha_, int value_ )
 {
     if (alpha_ == 'k')
     {
-        tree_.insert(value_);
+        if (insert_value(tree_, value_) && log_ != nullptr)
+        {
+            log_->insert(value_);
+        }
     }
     else if (alpha_ == 'm')
     {
-        std::cout << tree_.k_th_order_statistic(value_) << ' ';
+        output_.write(tree_.k_th_order_statistic(value_));
     }
     else if (alpha_ == 'n')
     {
-        std::cout << tree_.elem_less_than(value_) << ' ';
+        output_.write(tree_.elem_less_than(value_));
     }
     else
     {
@@ -130,6 +708,18 @@ void result(AVL_tree<int> & tree_, char alpha_, int value_ )
     }
 }
 
+bool insert_value(Tree_set & tree_, int value_)
+{
+    return tree_.insert(value_).second;
+}
+
+bool insert_value(Tree_multiset & tree_, int value_)
+{
+    // every copy changes the multiset
+    tree_.insert(value_);
+    return true;
+}
+
 void message1()
 {
     std::cerr << "\nUncorrect input:\n";
@@ -151,10 +741,94 @@ void message4()
     std::cerr << "\nUncorrect input: enter a letter\n";
     message2();
 }
-void message5(const AVL_tree<int> & tree_)
+void message5(int size_)
 {
     message1();
     std::cerr << "Enter any number to insert it into a container or to count how many elements less than it.\n";
     std::cerr << "To find k-th order statistic enter any positive number\n"
-              << " which is not bigger than quantity of elements in a container in this moment (" << tree_.size() << ").\n";
+              << " which is not bigger than quantity of elements in a container in this moment (" << size_ << ").\n";
+}
+void message6(const char * program_)
+{
+    std::cerr << "Usage: " << program_ << " [-f file] [--newline] [--quiet] [--multiset]"
+              << " [--wal file] [--snapshot file] [--sync-interval ms] [--wal-batch n] [--threads n] [--pipeline]\n";
+    std::cerr << "Commands are read from stdin or from the file.\n";
+    std::cerr << "Results are separated by spaces or by new lines with --newline.\n";
+    std::cerr << "With --quiet values which are already in the tree are only counted.\n";
+    std::cerr << "With --multiset such values are inserted again and 'm' and 'n' count every copy.\n";
+    std::cerr << "With --wal inserts are logged and replayed at the next start,\n"
+              << " --snapshot keeps the tree between runs, the log is cleared when the snapshot is saved.\n";
+    std::cerr << "With --threads n keys are divided between n trees with their own threads,\n"
+              << " it can not be used with --wal, --snapshot, --stats and --pipeline.\n";
+    std::cerr << "With --pipeline commands are read, executed and written by three threads.\n";
+#ifdef AVL_TREE_STATS
+    std::cerr << "Stats are written as JSON to stderr or to the file of --stats at the end and on SIGUSR1.\n";
+#endif
+}
+void message7(std::size_t duplicates_)
+{
+    std::cerr << "\n" << duplicates_ << " values were already in the tree\n";
+}
+// the same messages as the tree writes in the sharded mode
+void message8(int value_)
+{
+    std::cerr << "\nValue " << value_ << " is already in the tree" << std::endl;
+}
+void message9()
+{
+    std::cerr << "Uncorrect element number." << std::endl;
+}
+
+#ifdef AVL_TREE_STATS
+void request_stats(int)
+{
+    stats_requested = 1;
+}
+
+template<typename Tree>
+std::string format_stats(const Tree & tree_, const Latency_histogram latencies_[])
+{
+    std::ostringstream os;
+    const char letters[] = {'k', 'm', 'n'};
+
+    os << "{\"tree\": ";
+    tree_.stats().write_json(os);
+    os << ", \"latency\": {";
+
+    for (int i = 0; i < 3; ++i)
+    {
+        os << (i == 0 ? "\"" : ", \"") << letters[i] << "\": ";
+        latencies_[i].write_json(os);
+    }
+
+    os << "}}";
+
+    return os.str();
+}
+
+template<typename Tree>
+void write_stats(const Tree & tree_, const Latency_histogram latencies_[], const char * stats_name_)
+{
+    write_stats_line(format_stats(tree_, latencies_), stats_name_);
+}
+
+void write_stats_line(const std::string & line_, const char * stats_name_)
+{
+    std::ofstream file;
+
+    if (stats_name_ != nullptr)
+    {
+        file.open(stats_name_, std::ios::app);
+
+        if (!file)
+        {
+            std::cerr << "Can not open file " << stats_name_ << ": " << std::strerror(errno) << '\n';
+            return;
+        }
+    }
+
+    std::ostream & os = stats_name_ != nullptr ? file : std::cerr;
+
+    os << line_ << std::endl;
 }
+#endif
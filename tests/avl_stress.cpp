@@ -0,0 +1,549 @@
+#include "AVL_Tree.h"
+#include "AVL_Multiset.h"
+#include "B_Tree.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Randomized check of AVL_tree and AVL_multiset against std::set and std::map.
+// After random inserts, removes, splits, joins, merges and range erases the tree has to keep
+// heights, balance, quantities of elements and parent links of all nodes, and the same
+// elements, order statistics and counts of smaller elements as the reference.
+// Read-only views of the tree are checked in the same loop.
+// A mapped snapshot of a tree with another comparator has to answer as the tree.
+// B_tree is checked the same way with int keys, which are searched by vector instructions,
+// and with strings in the reverse order, which are searched by std::lower_bound.
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+void check(bool condition, const char * text, int line)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "avl_stress: line %d: %s failed\n", line, text);
+        std::exit(1);
+    }
+}
+
+template<typename Tree>
+void compare(const Tree & tree, const std::set<int> & reference, std::mt19937 & generator)
+{
+    CHECK(tree.is_valid());
+    CHECK(tree.size() == static_cast<int>(reference.size()));
+    CHECK(std::vector<int>(tree.begin(), tree.end()) == std::vector<int>(reference.begin(), reference.end()));
+
+    if (reference.empty())
+    {
+        return;
+    }
+
+    // a few random queries, all of them would take O(n^2) with the reference
+    std::vector<int> elements(reference.begin(), reference.end());
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int k = static_cast<int>(generator() % elements.size());
+        int item = static_cast<int>(generator() % 4000) - 2000;
+        CHECK(tree.k_th_order_statistic(k + 1) == elements[k]);
+        CHECK(tree.elem_less_than(item) == std::lower_bound(elements.begin(), elements.end(), item) - elements.begin());
+        CHECK(tree.is_there(item) == (reference.count(item) > 0));
+    }
+}
+
+// the Eytzinger snapshot has the same elements in both directions and the same answers
+template<typename Tree>
+void check_frozen(const Tree & tree, const std::set<int> & reference, std::mt19937 & generator)
+{
+    Frozen_AVL_tree<int> frozen = tree.freeze();
+    CHECK(frozen.size() == static_cast<int>(reference.size()));
+    CHECK(std::vector<int>(frozen.begin(), frozen.end()) == std::vector<int>(reference.begin(), reference.end()));
+
+    std::vector<int> backward;
+
+    for (Frozen_AVL_tree<int>::iterator it = frozen.end(); it != frozen.begin(); )
+    {
+        backward.push_back(*--it);
+    }
+
+    CHECK(std::equal(backward.begin(), backward.end(), reference.rbegin(), reference.rend()));
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int item = static_cast<int>(generator() % 4000) - 2000;
+        CHECK(frozen.is_there(item) == tree.is_there(item));
+        CHECK(frozen.elem_less_than(item) == tree.elem_less_than(item));
+
+        if (!reference.empty())
+        {
+            int k = static_cast<int>(generator() % reference.size()) + 1;
+            CHECK(frozen.k_th_order_statistic(k) == tree.k_th_order_statistic(k));
+        }
+    }
+}
+
+// batches of random queries, with repeated ones, are answered as single queries
+template<typename Tree>
+void check_batches(const Tree & tree, const std::set<int> & reference, std::mt19937 & generator)
+{
+    std::vector<int> elements(reference.begin(), reference.end());
+    std::vector<int> items(generator() % 300);
+    std::vector<int> less(items.size());
+
+    for (int & item : items)
+    {
+        item = static_cast<int>(generator() % 4000) - 2000;
+    }
+
+    tree.elem_less_than_batch(items, less);
+
+    for (std::size_t j = 0; j < items.size(); ++j)
+    {
+        CHECK(less[j] == std::lower_bound(elements.begin(), elements.end(), items[j]) - elements.begin());
+    }
+
+    if (elements.empty())
+    {
+        return;
+    }
+
+    std::vector<int> ranks(generator() % 300);
+    std::vector<int> statistics(ranks.size());
+
+    for (int & rank : ranks)
+    {
+        rank = static_cast<int>(generator() % elements.size()) + 1;
+    }
+
+    tree.k_th_batch(ranks, statistics);
+
+    for (std::size_t j = 0; j < ranks.size(); ++j)
+    {
+        CHECK(statistics[j] == elements[ranks[j] - 1]);
+    }
+}
+
+// bounds of random keys point to the same elements as in the reference, scans from them go to the end
+template<typename Tree>
+void check_bounds(const Tree & tree, const std::set<int> & reference, std::mt19937 & generator)
+{
+    for (int i = 0; i < 20; ++i)
+    {
+        int item = static_cast<int>(generator() % 4000) - 2000;
+        int last = item + static_cast<int>(generator() % 200) - 50;
+        typename Tree::template iterator<int> lower = tree.lower_bound(item);
+        typename Tree::template iterator<int> upper = tree.upper_bound(item);
+        std::set<int>::const_iterator reference_lower = reference.lower_bound(item);
+        std::set<int>::const_iterator reference_upper = reference.upper_bound(item);
+
+        CHECK((lower == tree.end()) == (reference_lower == reference.end()));
+        CHECK(lower == tree.end() || *lower == *reference_lower);
+        CHECK((upper == tree.end()) == (reference_upper == reference.end()));
+        CHECK(upper == tree.end() || *upper == *reference_upper);
+        CHECK(i > 0 || std::distance(lower, tree.end()) == std::distance(reference_lower, reference.end()));
+
+        std::pair<typename Tree::template iterator<int>, typename Tree::template iterator<int>> range = tree.equal_range(item);
+        CHECK(range.first == lower);
+        CHECK(range.second == upper);
+        CHECK(std::distance(range.first, range.second) == static_cast<int>(reference.count(item)));
+
+        int inside = item < last ? static_cast<int>(std::distance(reference_lower, reference.lower_bound(last))) : 0;
+        CHECK(tree.count_in_range(item, last) == inside);
+    }
+}
+
+// iterators go back by operator-- from the end and from any element, also in the reverse direction
+template<typename Tree>
+void check_iterators(const Tree & tree, const std::set<int> & reference, std::mt19937 & generator)
+{
+    using iterator = typename Tree::template iterator<int>;
+    std::vector<int> backward;
+    std::vector<int> forward;
+
+    for (iterator it = tree.end(); it != tree.begin(); )
+    {
+        backward.push_back(*--it);
+    }
+    for (iterator it = tree.rend(); it != tree.rbegin(); )
+    {
+        forward.push_back(*--it);
+    }
+
+    CHECK(std::equal(backward.begin(), backward.end(), reference.rbegin(), reference.rend()));
+    CHECK(std::vector<int>(tree.rbegin(), tree.rend()) == backward);
+    CHECK(std::vector<int>(reference.begin(), reference.end()) == forward);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int item = static_cast<int>(generator() % 4000) - 2000;
+        iterator it = tree.lower_bound(item);
+        std::set<int>::const_iterator reference_it = reference.lower_bound(item);
+
+        if (reference_it != reference.begin())
+        {
+            iterator previous = it--;
+            CHECK(*it == *std::prev(reference_it));
+            CHECK(++it == previous);
+        }
+    }
+}
+
+// value of the policy for elements from first to last, it is found by one pass
+template<typename Aggregate, typename InputIt>
+typename Aggregate::value_type fold(InputIt first, InputIt last)
+{
+    typename Aggregate::value_type value = Aggregate::identity();
+
+    for (; first != last; ++first)
+    {
+        value = Aggregate::combine(value, Aggregate::of(*first, 1));
+    }
+
+    return value;
+}
+
+// aggregates of prefixes, ranges of keys and ranges of ranks are the same as by a pass over the reference
+template<typename Tree, typename Aggregate>
+void check_aggregates(const Tree & tree, const std::set<int> & reference, std::mt19937 & generator)
+{
+    CHECK(tree.aggregate() == fold<Aggregate>(reference.begin(), reference.end()));
+
+    std::vector<int> elements(reference.begin(), reference.end());
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int item = static_cast<int>(generator() % 4000) - 2000;
+        int last = item + static_cast<int>(generator() % 400) - 100;
+        std::vector<int>::iterator lower = std::lower_bound(elements.begin(), elements.end(), item);
+
+        CHECK(tree.prefix_aggregate(item) == fold<Aggregate>(elements.begin(), lower));
+        CHECK(tree.range_aggregate(item, last) ==
+              (item < last ? fold<Aggregate>(lower, std::lower_bound(elements.begin(), elements.end(), last))
+                           : Aggregate::identity()));
+
+        if (!elements.empty())
+        {
+            int first_rank = static_cast<int>(generator() % elements.size()) + 1;
+            int last_rank = first_rank + static_cast<int>(generator() % (elements.size() - first_rank + 1));
+            CHECK(tree.rank_aggregate(first_rank, last_rank) ==
+                  fold<Aggregate>(elements.begin() + first_rank - 1, elements.begin() + last_rank));
+        }
+    }
+}
+
+template<typename Allocator, typename Aggregate = No_aggregate<int>>
+void stress_tree(unsigned seed, int operations)
+{
+    using Tree = AVL_tree<int, std::less<int>, Allocator, Aggregate>;
+    std::mt19937 generator(seed);
+    Tree tree;
+    std::set<int> reference;
+    tree.set_quiet(true);
+
+    for (int i = 0; i < operations; ++i)
+    {
+        int item = static_cast<int>(generator() % 4000) - 2000;
+        int operation = generator() % 100;
+
+        if (operation < 55)
+        {
+            CHECK(tree.insert(item).second == reference.insert(item).second);
+        }
+        else if (operation < 85)
+        {
+            if (reference.erase(item) > 0)
+            {
+                tree.remove(item);
+            }
+        }
+        else if (operation < 92)
+        {
+            // split by item and join the parts back
+            std::pair<Tree, Tree> parts = tree.split(item);
+            CHECK(parts.first.is_valid());
+            CHECK(parts.second.is_valid());
+            CHECK(parts.first.size() == std::distance(reference.begin(), reference.lower_bound(item)));
+            CHECK(tree.size() == 0);
+            parts.first.join(std::move(parts.second));
+            tree = std::move(parts.first);
+        }
+        else if (operation < 96)
+        {
+            // union with a small random tree
+            Tree other;
+            other.set_quiet(true);
+
+            for (int j = 0; j < 20; ++j)
+            {
+                int value = static_cast<int>(generator() % 4000) - 2000;
+                other.insert(value);
+                reference.insert(value);
+            }
+
+            tree.merge(std::move(other));
+        }
+        else if (operation < 97)
+        {
+            int last = item + static_cast<int>(generator() % 100);
+            int erased = static_cast<int>(std::distance(reference.lower_bound(item), reference.lower_bound(last)));
+            reference.erase(reference.lower_bound(item), reference.lower_bound(last));
+            CHECK(tree.erase_range(item, last) == erased);
+        }
+        else if (operation < 98 && !reference.empty())
+        {
+            // the same by ranks, from first to last
+            int first = static_cast<int>(generator() % reference.size()) + 1;
+            int last = std::min(first + static_cast<int>(generator() % 50), static_cast<int>(reference.size()));
+            std::set<int>::iterator begin = std::next(reference.begin(), first - 1);
+            reference.erase(begin, std::next(begin, last - first + 1));
+            CHECK(tree.erase_rank_range(first, last) == last - first + 1);
+        }
+        else if (operation < 99 && !reference.empty())
+        {
+            CHECK(tree.pop_min() == *reference.begin());
+            reference.erase(reference.begin());
+        }
+        else if (!reference.empty())
+        {
+            CHECK(tree.pop_max() == *reference.rbegin());
+            reference.erase(std::prev(reference.end()));
+        }
+
+        if (i % 500 == 0)
+        {
+            compare(tree, reference, generator);
+        }
+        if (i % 250 == 1)
+        {
+            check_frozen(tree, reference, generator);
+        }
+        if (i % 250 == 2)
+        {
+            check_batches(tree, reference, generator);
+        }
+        if (i % 250 == 3)
+        {
+            check_bounds(tree, reference, generator);
+        }
+        if (i % 250 == 4)
+        {
+            check_iterators(tree, reference, generator);
+        }
+        if constexpr (!std::is_same<Aggregate, No_aggregate<int>>::value)
+        {
+            if (i % 250 == 5)
+            {
+                check_aggregates<Tree, Aggregate>(tree, reference, generator);
+            }
+        }
+    }
+
+    compare(tree, reference, generator);
+}
+
+template<typename Tree, typename Key, typename Compare>
+void compare_b_tree(const Tree & tree, const std::set<Key, Compare> & reference, std::mt19937 & generator)
+{
+    std::vector<Key> elements(reference.begin(), reference.end());
+    CHECK(tree.size() == static_cast<int>(elements.size()));
+    CHECK(std::vector<Key>(tree.begin(), tree.end()) == elements);
+    CHECK(std::equal(tree.rbegin(), tree.rend(), elements.rbegin(), elements.rend()));
+
+    if (elements.empty())
+    {
+        return;
+    }
+
+    CHECK(tree.min() == elements.front());
+    CHECK(tree.max() == elements.back());
+    CHECK(*--tree.end() == elements.back());
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int k = static_cast<int>(generator() % elements.size());
+        const Key & item = elements[generator() % elements.size()];
+        CHECK(tree.k_th_order_statistic(k + 1) == elements[k]);
+        CHECK(tree.elem_less_than(item) == std::lower_bound(elements.begin(), elements.end(), item, Compare()) - elements.begin());
+    }
+}
+
+// make_key gives keys from numbers, several numbers can give one key
+template<typename Key, typename Compare, typename Allocator, typename Make_key>
+void stress_b_tree(unsigned seed, int operations, int range, Make_key make_key)
+{
+    using Tree = B_tree<Key, Compare, Allocator>;
+    std::mt19937 generator(seed);
+    Tree tree;
+    std::set<Key, Compare> reference;
+    tree.set_quiet(true);
+
+    for (int i = 0; i < operations; ++i)
+    {
+        Key item = make_key(static_cast<int>(generator() % range) - range / 2);
+        int operation = generator() % 100;
+
+        if (operation < 55)
+        {
+            std::pair<typename Tree::iterator, bool> inserted = tree.insert(item);
+            CHECK(inserted.second == reference.insert(item).second);
+            CHECK(*inserted.first == item);
+        }
+        else if (operation < 85)
+        {
+            if (reference.erase(item) > 0)
+            {
+                tree.remove(item);
+            }
+        }
+        else
+        {
+            CHECK(tree.is_there(item) == (reference.count(item) > 0));
+            // also for keys which are not in the tree, the reference takes O(n) here
+            CHECK(operation < 98 || tree.elem_less_than(item) == std::distance(reference.begin(), reference.lower_bound(item)));
+        }
+
+        if (i % 500 == 0)
+        {
+            compare_b_tree(tree, reference, generator);
+        }
+    }
+
+    compare_b_tree(tree, reference, generator);
+
+    // copies and moves keep all nodes
+    Tree copy(tree);
+    compare_b_tree(copy, reference, generator);
+    Tree moved(std::move(copy));
+    compare_b_tree(moved, reference, generator);
+    CHECK(copy.size() == 0);
+    Tree assigned;
+    assigned = moved;
+    compare_b_tree(assigned, reference, generator);
+    assigned = std::move(moved);
+    compare_b_tree(assigned, reference, generator);
+
+    // the tree is emptied in random order, leaves and inner nodes are merged down to the root
+    std::vector<Key> elements(reference.begin(), reference.end());
+    std::shuffle(elements.begin(), elements.end(), generator);
+
+    for (std::size_t j = 0; j < elements.size(); ++j)
+    {
+        tree.remove(elements[j]);
+        reference.erase(elements[j]);
+
+        if (j % 200 == 0)
+        {
+            compare_b_tree(tree, reference, generator);
+        }
+    }
+
+    CHECK(tree.size() == 0);
+    CHECK(tree.begin() == tree.end());
+    CHECK(tree.rbegin() == tree.rend());
+}
+
+void stress_multiset(unsigned seed, int operations)
+{
+    std::mt19937 generator(seed);
+    AVL_multiset<int> multiset;
+    std::map<int, int> reference;
+    int size = 0;
+
+    for (int i = 0; i < operations; ++i)
+    {
+        int item = static_cast<int>(generator() % 500);
+
+        if (generator() % 3 != 0)
+        {
+            multiset.insert(item);
+            ++reference[item];
+            ++size;
+        }
+        else if (reference.count(item) > 0)
+        {
+            multiset.remove(item);
+            --size;
+
+            if (--reference[item] == 0)
+            {
+                reference.erase(item);
+            }
+        }
+
+        if (i % 500 == 0)
+        {
+            CHECK(multiset.is_valid());
+            CHECK(multiset.size() == size);
+
+            int less = 0;
+
+            for (const std::pair<const int, int> & copies : reference)
+            {
+                CHECK(multiset.count(copies.first) == copies.second);
+                CHECK(multiset.elem_less_than(copies.first) == less);
+                CHECK(multiset.k_th_order_statistic(less + 1) == copies.first);
+                less += copies.second;
+            }
+        }
+    }
+}
+
+void stress_snapshot(unsigned seed, int operations)
+{
+    using Tree = AVL_tree<int, std::greater<int>>;
+    std::mt19937 generator(seed);
+    Tree tree;
+    tree.set_quiet(true);
+
+    for (int i = 0; i < operations; ++i)
+    {
+        tree.insert(static_cast<int>(generator() % 4000) - 2000);
+    }
+
+    std::string path = "avl_stress_" + std::to_string(seed) + ".snap";
+    CHECK(tree.save(path.c_str()));
+
+    {
+        Mapped_snapshot<int, std::greater<int>> snapshot(path.c_str());
+        CHECK(snapshot.is_open());
+        CHECK(snapshot.size() == tree.size());
+
+        for (int i = 0; i < 200; ++i)
+        {
+            int item = static_cast<int>(generator() % 4000) - 2000;
+            int k = static_cast<int>(generator() % tree.size()) + 1;
+            CHECK(snapshot.elem_less_than(item) == tree.elem_less_than(item));
+            CHECK(snapshot.is_there(item) == tree.is_there(item));
+            CHECK(snapshot.k_th_order_statistic(k) == tree.k_th_order_statistic(k));
+        }
+    }
+
+    std::remove(path.c_str());
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 20; ++seed)
+    {
+        stress_tree<std::allocator<int>>(seed, 20000);
+        stress_tree<Node_pool<int>, Sum_aggregate<int, long long>>(seed + 1000, 20000);
+        stress_multiset(seed, 20000);
+        stress_snapshot(seed, 5000);
+        stress_b_tree<int, std::less<int>, std::allocator<int>>(seed, 20000, 4000, [](int number) { return number; });
+        stress_b_tree<int, std::less<int>, Node_pool<int>>(seed + 1000, 20000, 100000, [](int number) { return number; });
+        stress_b_tree<std::string, std::greater<std::string>, std::allocator<std::string>>(seed, 20000, 4000,
+                                                                                        [](int number) { return std::to_string(number); });
+    }
+
+    std::printf("avl_stress: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "Concurrent_AVL_Tree.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <latch>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Readers of Concurrent_AVL_tree run while one writer inserts and removes keys.
+// Multiples of 4 are inserted before the readers start and are never removed, the writer changes
+// only other keys, so every version which a reader can see has all of them, and nothing outside
+// of the keys. At the end the tree has to have the same elements as the reference of the writer.
+// More readers than Reader_registry::max_readers_ have to read without numbers too.
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+void check(bool condition, const char * text, int line)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "concurrent_stress: line %d: %s failed\n", line, text);
+        std::exit(1);
+    }
+}
+
+const int keys = 4000;
+
+void read_tree(const Concurrent_AVL_tree<int> & tree, const std::atomic<bool> & done, unsigned seed)
+{
+    std::mt19937 generator(seed);
+
+    while (!done.load(std::memory_order_acquire))
+    {
+        int item = static_cast<int>(generator() % (keys + 100)) - 50;
+        int key = (item + 100) / 4 * 4 - 100; // the nearest multiple of 4 which is not greater
+        int less = tree.elem_less_than(item);
+
+        CHECK(tree.is_there(key) == (key >= 0 && key < keys));
+        CHECK(less >= (item <= 0 ? 0 : (std::min(item, keys) + 3) / 4));
+        CHECK(less <= (item <= 0 ? 0 : std::min(item, keys)));
+        CHECK(tree.k_th_order_statistic(1) == 0);
+        CHECK(tree.size() >= keys / 4);
+    }
+}
+
+void stress(unsigned seed, int readers, int operations)
+{
+    Concurrent_AVL_tree<int> tree;
+    std::set<int> reference;
+    std::atomic<bool> done(false);
+
+    for (int item = 0; item < keys; item += 4)
+    {
+        tree.insert(item);
+        reference.insert(item);
+    }
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < readers; ++i)
+    {
+        threads.emplace_back(read_tree, std::cref(tree), std::cref(done), seed * 100 + i);
+    }
+
+    // the writer is the calling thread
+    std::mt19937 generator(seed);
+
+    for (int i = 0; i < operations; ++i)
+    {
+        int item = static_cast<int>(generator() % keys);
+
+        if (item % 4 == 0)
+        {
+            continue;
+        }
+        if (generator() % 2 == 0)
+        {
+            CHECK(tree.insert(item) == reference.insert(item).second);
+        }
+        else
+        {
+            CHECK(tree.remove(item) == (reference.erase(item) > 0));
+        }
+    }
+
+    done.store(true, std::memory_order_release);
+
+    for (std::thread & thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(tree.size() == static_cast<int>(reference.size()));
+
+    int k = 1;
+
+    for (int item : reference)
+    {
+        CHECK(tree.k_th_order_statistic(k++) == item);
+    }
+    for (int item = -10; item < keys + 10; ++item)
+    {
+        CHECK(tree.is_there(item) == (reference.count(item) > 0));
+    }
+}
+
+void many_readers(int readers)
+{
+    Concurrent_AVL_tree<int> tree;
+    std::latch numbered(readers); // all threads keep their numbers, or have none, at the same time
+
+    for (int item = 0; item < keys; item += 4)
+    {
+        tree.insert(item);
+    }
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < readers; ++i)
+    {
+        threads.emplace_back([&tree, &numbered, i]()
+        {
+            CHECK(tree.is_there(i % keys / 4 * 4));
+            numbered.arrive_and_wait();
+
+            for (int j = 0; j < 100; ++j)
+            {
+                CHECK(tree.is_there((i + j) % keys / 4 * 4));
+                CHECK(tree.k_th_order_statistic(1) == 0);
+            }
+        });
+    }
+
+    numbered.wait();
+
+    for (int item = 1; item < keys; item += 2)
+    {
+        tree.insert(item);
+        tree.remove(item);
+    }
+
+    for (std::thread & thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(tree.size() == keys / 4);
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 5; ++seed)
+    {
+        stress(seed, 4, 50000);
+    }
+
+    many_readers(Reader_registry::max_readers_ + 16);
+
+    std::printf("concurrent_stress: ok\n");
+
+    return 0;
+}
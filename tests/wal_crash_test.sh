@@ -0,0 +1,55 @@
+#!/bin/sh
+# Recovery of creating_avl_tree with --wal and --snapshot after crashes.
+# usage: wal_crash_test.sh path/to/creating_avl_tree
+
+program=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+cd "$directory" || exit 1
+
+fail()
+{
+    echo "wal_crash_test: $1" >&2
+    exit 1
+}
+
+# the process stops after the snapshot is saved but before the log is cleared:
+# the old log is put back, and its records must not be replayed again over the snapshot
+for mode in "" "--pipeline"; do
+    rm -f tree.wal tree.wal.old tree.snap
+    printf 'k 5 k 5 k 7\n' | "$program" $mode --multiset --wal tree.wal > /dev/null
+    cp tree.wal tree.wal.old
+    printf '\n' | "$program" $mode --multiset --wal tree.wal --snapshot tree.snap > /dev/null
+    cp tree.wal.old tree.wal
+
+    answer=$(printf 'n 6 n 100\n' | "$program" $mode --multiset --wal tree.wal --snapshot tree.snap)
+    [ "$answer" = "2 3 " ] || fail "log replayed twice over the snapshot $mode: '$answer'"
+done
+
+# the process is killed while it reads commands: inserts which came before a pause of the input
+# are acknowledged and have to be in the log after --sync-interval, also in a partial batch
+mkfifo input
+for mode in "" "--pipeline"; do
+    rm -f tree.wal
+    "$program" $mode --quiet --wal tree.wal --wal-batch 1024 --sync-interval 10 < input > /dev/null &
+    pid=$!
+    exec 3> input
+
+    value=1
+    while [ $value -le 500 ]; do
+        printf 'k %d ' $value >&3
+        value=$((value + 1))
+    done
+
+    sleep 1
+    # inserts after the pause may be lost
+    printf 'k 1000 k 1001 k 1002 ' >&3
+    kill -9 $pid
+    wait $pid 2> /dev/null
+    exec 3>&-
+
+    answer=$(printf 'n 501 m 1 m 500\n' | "$program" $mode --wal tree.wal)
+    [ "$answer" = "500 1 500 " ] || fail "acknowledged inserts are lost after SIGKILL $mode: '$answer'"
+done
+
+echo "wal_crash_test: ok"
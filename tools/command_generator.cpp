@@ -0,0 +1,357 @@
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// Writes a stream of commands like "k 8 m 1 n 3" for creating_avl_tree.
+// All commands are in one line, like the program reads them. Inserted keys are counted exactly,
+// so 'm' always asks for an existing order statistic and the program gives no messages
+// except the injected errors.
+
+struct Options
+{
+    long long commands_ = 1000000;
+    int insert_weight_ = 50;  // weights of 'k', 'm' and 'n' commands
+    int k_th_weight_ = 25;
+    int less_weight_ = 25;
+    std::string distribution_ = "uniform";
+    double duplicate_ratio_ = 0.0;  // part of inserts which repeat an inserted key
+    double error_rate_ = 0.0;       // part of commands with a missed space or a wrong letter
+    std::uint64_t seed_ = 1;
+    const char * output_ = nullptr;
+};
+
+std::uint32_t scramble(std::uint32_t x)
+{
+    // a bijection of 32-bit numbers, so different indexes give different keys
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Zipf distribution over [0, size) with theta 0.99 by the method of Gray et al.
+class Zipf_distribution
+{
+    private:
+        double size_;
+        double theta_;
+        double zeta_2_;
+        double zeta_n_;
+        double alpha_;
+        double eta_;
+    public:
+        Zipf_distribution(long long size, double theta = 0.99) : size_(static_cast<double>(size)), theta_(theta)
+        {
+            // the sum is exact for the first million of terms, the rest is an integral
+            const long long exact = 1000000;
+            zeta_n_ = 0;
+
+            for (long long i = 1; i <= size && i <= exact; ++i)
+                zeta_n_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+
+            if (size > exact)
+            {
+                zeta_n_ += (std::pow(size_, 1.0 - theta_) - std::pow(static_cast<double>(exact), 1.0 - theta_)) / (1.0 - theta_);
+            }
+
+            zeta_2_ = 1.0 + 1.0 / std::pow(2.0, theta_);
+            alpha_ = 1.0 / (1.0 - theta_);
+            eta_ = (1.0 - std::pow(2.0 / size_, 1.0 - theta_)) / (1.0 - zeta_2_ / zeta_n_);
+        }
+        template<typename Generator>
+        long long operator()(Generator & generator)
+        {
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+            double uz = u * zeta_n_;
+
+            if (uz < 1.0) return 0;
+            if (uz < zeta_2_) return 1;
+
+            long long rank = static_cast<long long>(size_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+            return rank < size_ ? rank : static_cast<long long>(size_) - 1;
+        }
+};
+
+class Command_generator
+{
+    private:
+        static const std::size_t recent_size_ = 4096;
+        const Options & options_;
+        std::mt19937_64 random_;
+        std::FILE * file_;
+        long long new_keys_;            // index of the next new key
+        long long tree_size_;           // quantity of different inserted keys
+        std::vector<int> recent_;       // the last inserted keys for duplicates and 'n' queries
+        std::vector<bool> zipf_used_;   // zipf ranks which are already inserted
+        Zipf_distribution zipf_;
+        bool first_;
+        int new_key();
+        void write(char letter, long long value, bool missed_space);
+    public:
+        Command_generator(const Options & options, std::FILE * file, long long inserts);
+        void run();
+};
+
+Command_generator::Command_generator(const Options & options, std::FILE * file, long long inserts) : options_(options),
+                                                                                                     random_(options.seed_),
+                                                                                                     file_(file),
+                                                                                                     new_keys_(0),
+                                                                                                     tree_size_(0),
+                                                                                                     zipf_(inserts > 1 ? inserts : 2),
+                                                                                                     first_(true)
+{
+    recent_.reserve(recent_size_);
+
+    if (options_.distribution_ == "zipf")
+    {
+        zipf_used_.resize(inserts > 1 ? inserts : 2);
+    }
+}
+
+int Command_generator::new_key()
+{
+    // the key of the next insert, it is counted as a new element if it was not inserted before
+    long long index = new_keys_;
+    int key;
+
+    if (options_.distribution_ == "sorted")
+    {
+        key = static_cast<int>(index - INT32_MAX / 2);
+    }
+    else if (options_.distribution_ == "reverse")
+    {
+        key = static_cast<int>(INT32_MAX / 2 - index);
+    }
+    else if (options_.distribution_ == "clustered")
+    {
+        // runs of 1024 neighbouring keys in different places
+        std::uint32_t cluster = scramble(static_cast<std::uint32_t>(index >> 10)) & 0x1fffff;
+        key = static_cast<int>((cluster << 10) | (index & 1023)) - (1 << 30);
+    }
+    else if (options_.distribution_ == "zipf")
+    {
+        long long rank = zipf_(random_);
+        key = static_cast<int>(scramble(static_cast<std::uint32_t>(rank)));
+
+        if (zipf_used_[rank])
+        {
+            return key;
+        }
+        zipf_used_[rank] = true;
+    }
+    else // uniform
+    {
+        key = static_cast<int>(scramble(static_cast<std::uint32_t>(index)));
+    }
+
+    ++new_keys_;
+    ++tree_size_;
+
+    return key;
+}
+
+void Command_generator::write(char letter, long long value, bool missed_space)
+{
+    char buffer[32];
+    char * end = buffer;
+
+    if (!first_)
+    {
+        *end++ = ' ';
+    }
+    first_ = false;
+
+    *end++ = letter;
+
+    if (!missed_space)
+    {
+        *end++ = ' ';
+    }
+
+    end = std::to_chars(end, buffer + sizeof(buffer), value).ptr;
+    std::fwrite(buffer, 1, end - buffer, file_);
+}
+
+void Command_generator::run()
+{
+    std::uniform_int_distribution<int> command(1, options_.insert_weight_ + options_.k_th_weight_ + options_.less_weight_);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    const char wrong_letters[] = "abcdefghijlopqrstuvwxyz";
+
+    for (long long i = 0; i < options_.commands_; ++i)
+    {
+        int kind = command(random_);
+        bool error = chance(random_) < options_.error_rate_;
+        bool missed_space = error && chance(random_) < 0.5;
+        bool wrong_letter = error && !missed_space;
+        char letter;
+        long long value;
+
+        if (kind <= options_.insert_weight_ || tree_size_ == 0)
+        {
+            letter = 'k';
+
+            if (!recent_.empty() && chance(random_) < options_.duplicate_ratio_)
+            {
+                value = recent_[std::uniform_int_distribution<std::size_t>(0, recent_.size() - 1)(random_)];
+            }
+            else if (wrong_letter)
+            {
+                // the command will not be executed, so the key is not taken
+                value = static_cast<int>(scramble(static_cast<std::uint32_t>(random_())));
+            }
+            else
+            {
+                value = new_key();
+
+                if (recent_.size() < recent_size_)
+                {
+                    recent_.push_back(static_cast<int>(value));
+                }
+                else
+                {
+                    recent_[random_() % recent_size_] = static_cast<int>(value);
+                }
+            }
+        }
+        else if (kind <= options_.insert_weight_ + options_.k_th_weight_)
+        {
+            letter = 'm';
+            value = std::uniform_int_distribution<long long>(1, tree_size_)(random_);
+        }
+        else
+        {
+            // near inserted keys, so the answers are different
+            letter = 'n';
+            value = static_cast<long long>(recent_[std::uniform_int_distribution<std::size_t>(0, recent_.size() - 1)(random_)]) +
+                    std::uniform_int_distribution<int>(-1, 1)(random_);
+
+            if (value > INT32_MAX || value < INT32_MIN)
+            {
+                value = 0;
+            }
+        }
+
+        if (wrong_letter)
+        {
+            letter = wrong_letters[random_() % (sizeof(wrong_letters) - 1)];
+        }
+
+        write(letter, value, missed_space);
+    }
+
+    std::fputc('\n', file_);
+}
+
+void usage(const char * program)
+{
+    std::fprintf(stderr, "Usage: %s [--commands n] [--mix k:m:n] [--distribution uniform|sorted|reverse|zipf|clustered]\n"
+                         "       [--dup-ratio p] [--error-rate p] [--seed s] [-o file]\n", program);
+    std::fprintf(stderr, "Writes n commands in one line to stdout or to the file, the same seed gives the same commands.\n");
+    std::fprintf(stderr, "--mix gives weights of inserts, order statistics and counts of smaller elements (50:25:25).\n");
+    std::fprintf(stderr, "--dup-ratio is the part of inserts which repeat inserted keys,\n"
+                         "--error-rate is the part of commands with a missed space or a wrong letter.\n");
+}
+
+bool parse_mix(const char * text, Options & options)
+{
+    return std::sscanf(text, "%d:%d:%d", &options.insert_weight_, &options.k_th_weight_, &options.less_weight_) == 3 &&
+           options.insert_weight_ > 0 && options.k_th_weight_ >= 0 && options.less_weight_ >= 0;
+}
+
+int main(int argc, char * argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--commands") == 0 && i + 1 < argc)
+        {
+            options.commands_ = std::atoll(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--mix") == 0 && i + 1 < argc)
+        {
+            if (!parse_mix(argv[++i], options))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--distribution") == 0 && i + 1 < argc)
+        {
+            options.distribution_ = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--dup-ratio") == 0 && i + 1 < argc)
+        {
+            options.duplicate_ratio_ = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--error-rate") == 0 && i + 1 < argc)
+        {
+            options.error_rate_ = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            options.seed_ = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((std::strcmp(argv[i], "-o") == 0 || std::strcmp(argv[i], "--output") == 0) && i + 1 < argc)
+        {
+            options.output_ = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    const std::string distributions[] = {"uniform", "sorted", "reverse", "zipf", "clustered"};
+    bool known = false;
+
+    for (const std::string & distribution : distributions)
+        known = known || distribution == options.distribution_;
+
+    if (!known || options.commands_ < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::FILE * file = stdout;
+
+    if (options.output_ != nullptr)
+    {
+        file = std::fopen(options.output_, "wb");
+
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Can not open file %s: %s\n", options.output_, std::strerror(errno));
+            return 1;
+        }
+    }
+
+    static std::vector<char> buffer(1 << 20);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    // zipf ranks are taken from the expected quantity of inserts
+    long long inserts = options.commands_ * options.insert_weight_ /
+                        (options.insert_weight_ + options.k_th_weight_ + options.less_weight_) + 1;
+    Command_generator generator(options, file, inserts);
+    generator.run();
+
+    if (std::fflush(file) != 0 || (file != stdout && std::fclose(file) != 0))
+    {
+        std::fprintf(stderr, "Can not write commands: %s\n", std::strerror(errno));
+        return 1;
+    }
+
+    return 0;
+}